@@ -0,0 +1,102 @@
+#include "ANSCoder.h"
+
+//
+// Encoding functions
+//
+
+void ANSCoder::encode(const vector<uchar>& data, vector<uchar>& encodedData) {
+	if (data.empty())
+		return;
+
+	// Normalize the symbols frequencies and store them in the header
+	table.build(data, TOTAL_FRQ_BITS);
+	table.encode(encodedData);
+
+	// Encode the symbols count
+	int n = data.size();
+	for (int k = 0; k < 4; ++k) {
+		encodedData.push_back(n >> (8 * k));
+	}
+
+	// The decoder pops the symbols in the reverse order of their encoding,
+	// so encode them from the last one and reverse the produced bytes
+	uint32_t states[STATES_COUNT];
+	fill(states, states + STATES_COUNT, STATE_BOTTOM);
+
+	vector<uchar> reversedData;
+	for (int i = n - 1; i >= 0; --i) {
+		encodeSymbol(states[i % STATES_COUNT], data[i], reversedData);
+	}
+
+	// Flush the final states so that the decoder reads the first state first
+	for (int s = STATES_COUNT - 1; s >= 0; --s) {
+		for (int k = 3; k >= 0; --k) {
+			reversedData.push_back(states[s] >> (8 * k));
+		}
+	}
+
+	encodedData.insert(encodedData.end(), reversedData.rbegin(), reversedData.rend());
+}
+
+void ANSCoder::encodeSymbol(uint32_t& state, uchar symbol, vector<uchar>& reversedData) {
+	uint32_t freq = table.symbolsFrq[symbol];
+
+	// Renormalize so that the state stays in range after pushing the symbol
+	uint32_t stateMax = ((STATE_BOTTOM >> TOTAL_FRQ_BITS) << 8) * freq;
+	while (state >= stateMax) {
+		reversedData.push_back(state & 255);
+		state >>= 8;
+	}
+
+	state = ((state / freq) << TOTAL_FRQ_BITS) + (state % freq) + table.symbolsFrqPrefixSum[symbol];
+}
+
+// ==============================================================================
+//
+// Decoding functions
+//
+
+void ANSCoder::decode(const vector<uchar>& data, vector<uchar>& decodedData) {
+	if (data.empty())
+		return;
+
+	dataIdx = table.decode(data) - 1;
+
+	// Decode the symbols count
+	int n = 0;
+	for (int k = 0; k < 4; ++k) {
+		n |= data[++dataIdx] << (8 * k);
+	}
+
+	table.buildSlots(TOTAL_FRQ_BITS);
+
+	// Read the initial states
+	uint32_t states[STATES_COUNT];
+	for (int s = 0; s < STATES_COUNT; ++s) {
+		states[s] = 0;
+		for (int k = 0; k < 4; ++k) {
+			states[s] |= (uint32_t)(dataIdx + 1 < data.size() ? data[++dataIdx] : 0) << (8 * k);
+		}
+	}
+
+	int offset = decodedData.size();
+	decodedData.resize(offset + n);
+	for (int i = 0; i < n; ++i) {
+		decodedData[offset + i] = decodeSymbol(states[i % STATES_COUNT], data);
+	}
+}
+
+uchar ANSCoder::decodeSymbol(uint32_t& state, const vector<uchar>& data) {
+	// The lowest bits of the state select the symbol's cumulative frequency slot
+	uint32_t slot = state & ((1 << TOTAL_FRQ_BITS) - 1);
+	uchar symbol = table.slotSymbols[slot];
+
+	state = table.symbolsFrq[symbol] * (state >> TOTAL_FRQ_BITS) + slot - table.symbolsFrqPrefixSum[symbol];
+
+	// Renormalize
+	while (state < STATE_BOTTOM) {
+		state = (state << 8) | (dataIdx + 1 < data.size() ? data[++dataIdx] : 0);
+	}
+
+	return symbol;
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "FrequencyTable.h"
+using namespace std;
+
+typedef unsigned char uchar;
+
+/**
+ * Static range asymmetric numeral systems (rANS) coder with two interleaved states,
+ * symbols are decoded by a table lookup, a multiplication and shifts only
+ */
+class ANSCoder
+{
+private:
+	const int TOTAL_FRQ_BITS = 12;				// Normalized frequencies sum up to 2^TOTAL_FRQ_BITS
+	const uint32_t STATE_BOTTOM = 1 << 23;		// States are kept in [STATE_BOTTOM, STATE_BOTTOM * 256)
+	static const int STATES_COUNT = 2;			// Number of interleaved states
+
+	int dataIdx;
+	FrequencyTable table;						// Normalized symbols frequencies stored in the header
+
+	// ==============================================================================
+	//
+	// Encoding functions
+	//
+public:
+	/**
+	 * Encode the passed data in reverse order into the states of the coder,
+	 * the i-th symbol is encoded by the (i % STATES_COUNT)-th state
+	 */
+	void encode(const vector<uchar>& data, vector<uchar>& encodedData);
+
+private:
+	/**
+	 * Push the given symbol into the given state, the renormalization bytes
+	 * are appended to the given reversed output
+	 */
+	void encodeSymbol(uint32_t& state, uchar symbol, vector<uchar>& reversedData);
+
+	// ==============================================================================
+	//
+	// Decoding functions
+	//
+public:
+	/**
+	 * Decode the passed data by popping the symbols out of the coder states
+	 */
+	void decode(const vector<uchar>& data, vector<uchar>& decodedData);
+
+private:
+	uchar decodeSymbol(uint32_t& state, const vector<uchar>& data);
+};
\ No newline at end of file
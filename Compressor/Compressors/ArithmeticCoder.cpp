@@ -0,0 +1,118 @@
+#include "ArithmeticCoder.h"
+
+//
+// Encoding functions
+//
+
+void ArithmeticCoder::encode(const vector<uchar>& data, vector<uchar>& encodedData) {
+	if (data.empty())
+		return;
+
+	// Normalize the symbols frequencies and store them in the header
+	table.build(data, TOTAL_FRQ_BITS);
+	table.encode(encodedData);
+
+	// Encode the symbols count as the range coder has no end of data marker
+	int n = data.size();
+	for (int k = 0; k < 4; ++k) {
+		encodedData.push_back(n >> (8 * k));
+	}
+
+	// Range encoding
+	low = 0;
+	range = 0xFFFFFFFF;
+	cache = 0;
+	cacheSize = 1;
+
+	for (int i = 0; i < data.size(); ++i) {
+		encodeSymbol(data[i], encodedData);
+	}
+
+	// Encoder flush
+	for (int i = 0; i < 5; ++i) {
+		shiftLow(encodedData);
+	}
+}
+
+void ArithmeticCoder::encodeSymbol(uchar symbol, vector<uchar>& encodedData) {
+	// Narrow the range to the symbol's sub-range
+	uint32_t r = range >> TOTAL_FRQ_BITS;
+	low += (uint64_t)r * table.symbolsFrqPrefixSum[symbol];
+	range = r * table.symbolsFrq[symbol];
+
+	// Renormalize
+	while (range < RANGE_BOTTOM) {
+		range <<= 8;
+		shiftLow(encodedData);
+	}
+}
+
+void ArithmeticCoder::shiftLow(vector<uchar>& encodedData) {
+	if ((uint32_t)low < 0xFF000000 || (low >> 32) != 0) {
+		// The pending bytes are final now, propagate the carry into them
+		uchar carry = low >> 32;
+		uchar byte = cache;
+
+		do {
+			encodedData.push_back(byte + carry);
+			byte = 0xFF;
+		} while (--cacheSize != 0);
+
+		cache = (low >> 24) & 0xFF;
+	}
+
+	++cacheSize;
+	low = (low & 0x00FFFFFF) << 8;
+}
+
+// ==============================================================================
+//
+// Decoding functions
+//
+
+void ArithmeticCoder::decode(const vector<uchar>& data, vector<uchar>& decodedData) {
+	if (data.empty())
+		return;
+
+	dataIdx = table.decode(data) - 1;
+
+	// Decode the symbols count
+	int n = 0;
+	for (int k = 0; k < 4; ++k) {
+		n |= data[++dataIdx] << (8 * k);
+	}
+
+	table.buildSlots(TOTAL_FRQ_BITS);
+
+	// Range decoding, the first byte is always the initial empty cache
+	range = 0xFFFFFFFF;
+	code = 0;
+	for (int i = 0; i < 5; ++i) {
+		code = (code << 8) | (dataIdx + 1 < data.size() ? data[++dataIdx] : 0);
+	}
+
+	decodedData.reserve(decodedData.size() + n);
+	for (int i = 0; i < n; ++i) {
+		decodedData.push_back(decodeSymbol(data));
+	}
+}
+
+uchar ArithmeticCoder::decodeSymbol(const vector<uchar>& data) {
+	// Find the cumulative frequency slot that the code falls in, the scaled range
+	// changes with every symbol so the slot needs a division unlike the encoder
+	uint32_t r = range >> TOTAL_FRQ_BITS;
+	uint32_t slot = min(code / r, (uint32_t)(1 << TOTAL_FRQ_BITS) - 1);
+	uchar symbol = table.slotSymbols[slot];
+
+	// Narrow the range to the symbol's sub-range
+	code -= r * table.symbolsFrqPrefixSum[symbol];
+	range = r * table.symbolsFrq[symbol];
+
+	// Renormalize
+	while (range < RANGE_BOTTOM) {
+		range <<= 8;
+		code = (code << 8) | (dataIdx + 1 < data.size() ? data[++dataIdx] : 0);
+	}
+
+	return symbol;
+}
\ No newline at end of file
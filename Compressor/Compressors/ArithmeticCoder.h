@@ -0,0 +1,69 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "FrequencyTable.h"
+using namespace std;
+
+typedef unsigned char uchar;
+
+/**
+ * Static range coder with symbol frequencies normalized to a power of two total,
+ * so that the encoder scales the coding range by shifts instead of divisions;
+ * the decoder still divides once per symbol to find the symbol's frequency slot
+ */
+class ArithmeticCoder
+{
+private:
+	const int TOTAL_FRQ_BITS = 15;				// Normalized frequencies sum up to 2^TOTAL_FRQ_BITS
+	const uint32_t RANGE_BOTTOM = 1 << 24;		// Range is renormalized whenever it drops below this value
+
+	int dataIdx;
+	FrequencyTable table;						// Normalized symbols frequencies stored in the header
+
+	// Range encoder state
+	uint64_t low;
+	uint32_t range;
+	uchar cache;
+	long long cacheSize;
+
+	// Range decoder state
+	uint32_t code;
+
+	// ==============================================================================
+	//
+	// Encoding functions
+	//
+public:	
+	/**
+	 * Encode the passed data by narrowing the coding range according to
+	 * the probability of each symbol
+	 */
+	void encode(const vector<uchar>& data, vector<uchar>& encodedData);
+
+private:
+	void encodeSymbol(uchar symbol, vector<uchar>& encodedData);
+
+	/**
+	 * Output the top byte of the low bound, delaying 0xFF bytes until
+	 * the carry into them is known
+	 */
+	void shiftLow(vector<uchar>& encodedData);
+
+	// ==============================================================================
+	//
+	// Decoding functions
+	//
+public:
+	/**
+	 * Decode the passed data by retrieving the symbols frequencies and mapping
+	 * the coding range back to the symbols
+	 */
+	void decode(const vector<uchar>& data, vector<uchar>& decodedData);
+
+private:
+	uchar decodeSymbol(const vector<uchar>& data);
+};
\ No newline at end of file
@@ -5,35 +5,14 @@
 //
 
 void LZWBitConcatenator::concatenate(const vector<int>& data, vector<uchar>& outputData) {
-	// Clear previous data
-	dataBitStr.clear();
+	BitWriter writer(outputData);
 
 	// Concatenate data
 	for (int i = 0; i < data.size(); ++i) {
-		string bitStr = toBinary(data[i]);
-		dataBitStr += bitStr + string(14 - (int)bitStr.size(), '0');
+		writer.writeBits(data[i] & ((1 << CODE_LENGTH) - 1), CODE_LENGTH);
 	}
 
-	encodeBitString(dataBitStr, outputData);
-}
-
-void LZWBitConcatenator::encodeBitString(const string& str, vector<uchar>& outputData) {
-	int byte = 0;
-	int bitsCount = 0;
-
-	for (int i = 0; i < str.size(); ++i) {
-		byte |= (str[i] - '0') << bitsCount++;
-
-		if (bitsCount >= 8) {
-			outputData.push_back(byte);
-			byte = 0;
-			bitsCount = 0;
-		}
-	}
-
-	if (bitsCount > 0) {
-		outputData.push_back(byte);
-	}
+	writer.flush();
 }
 
 // ==============================================================================
@@ -42,54 +21,18 @@ void LZWBitConcatenator::encodeBitString(const string& str, vector<uchar>& outpu
 //
 
 void LZWBitConcatenator::deconcatenate(const vector<int>& data, vector<int>& outputData) {
-	// Clear previous data
-	dataBitStr.clear();
-
-	// Concatenate data
+	// Split the given 32-bit words into bytes, most significant byte first
+	vector<uchar> bytes;
 	for (int i = 0; i < data.size(); ++i) {
-		string bitStr = toBinary(data[i]);
-		dataBitStr += bitStr + string(32 - (int)bitStr.size(), '0');
+		bytes.push_back(data[i] >> 24);
+		bytes.push_back(data[i] >> 16);
+		bytes.push_back(data[i] >> 8);
+		bytes.push_back(data[i]);
 	}
 
-	decodeBitString(outputData);
-}
-
-void LZWBitConcatenator::decodeBitString(vector<int>& outputData) {
-	int l = 0;
+	BitReader reader(bytes.data(), bytes.size());
 
-	while (l + 14 <= dataBitStr.size()) {
-		string binary = dataBitStr.substr(l, 14);
-		l += 14;
-		outputData.push_back(toDecimal(binary));
+	for (long long l = 0; l + CODE_LENGTH <= 8LL * bytes.size(); l += CODE_LENGTH) {
+		outputData.push_back((int)reader.readBits(CODE_LENGTH));
 	}
-}
-
-// ==============================================================================
-//
-// Helper functions
-//
-
-string LZWBitConcatenator::toBinary(int number) {
-	if (number == 0) {
-		return "0";
-	}
-
-	string bitStr;
-
-	while (number > 0) {
-		bitStr += '0' + (number & 1);
-		number >>= 1;
-	}
-
-	return bitStr;
-}
-
-int LZWBitConcatenator::toDecimal(string& binary) {
-	int num = 0;
-
-	for (int i = 0; i < binary.size(); ++i) {
-		num |= (binary[i] - '0') << i;
-	}
-
-	return num;
 }
\ No newline at end of file
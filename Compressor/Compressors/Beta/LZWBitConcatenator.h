@@ -5,6 +5,7 @@
 #include <stack>
 #include <map>
 #include <algorithm>
+#include "../BitStream.h"
 using namespace std;
 
 typedef unsigned char uchar;
@@ -12,7 +13,7 @@ typedef unsigned char uchar;
 class LZWBitConcatenator
 {
 private:
-	string dataBitStr;
+	const int CODE_LENGTH = 14;
 
 	// ==============================================================================
 	//
@@ -21,25 +22,10 @@ private:
 public:
 	void concatenate(const vector<int>& data, vector<uchar>& outputData);
 
-private:
-	void encodeBitString(const string& str, vector<uchar>& outputData);
-
 	// ==============================================================================
 	//
 	// Deconcatenation functions
 	//
 public:
 	void deconcatenate(const vector<int>& data, vector<int>& outputData);
-
-private:
-	void decodeBitString(vector<int>& outputData);
-
-	// ==============================================================================
-	//
-	// Helper functions
-	//
-private:
-	string toBinary(int number);
-
-	int toDecimal(string& binary);
 };
\ No newline at end of file
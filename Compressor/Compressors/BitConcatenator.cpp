@@ -6,48 +6,105 @@
 
 void BitConcatenator::concatenate(const vector<int>& data, vector<uchar>& outputData) {
 	// Clear previous data
-	dataBitStr.clear();
 	compressedData.clear();
 	compressedDataSizes.clear();
 
+	// Choose and store the block lengths
+	selectBlockLengths(data);
+	encodeBlockLengths();
+
 	// Concatenate data
+	BitWriter writer(compressedData);
 	for (int i = 0; i < data.size(); ++i) {
-		encodeBinary(data[i]);
+		encodeBinary(writer, data[i]);
 	}
-	
-	encodeBitString(dataBitStr);
+	writer.flush();
+
 	encodeDataSizes();
 
 	// Swap the two vectors to return concatenated data to function caller
 	outputData.swap(compressedData);
 }
 
-void BitConcatenator::encodeBitString(const string& str) {
-	uchar byte = 0;
-	int bitsCount = 8;
+void BitConcatenator::selectBlockLengths(const vector<int>& data) {
+	// Group the numbers into runs of equal bit lengths
+	vector<pair<int, int>> runs;
+	vector<long long> lengthFrq(MAX_BLOCK_LENGTH + 1, 0);
+	int maxLength = 1;
 
-	for (int j = 0; j < str.size(); ++j) {
-		byte |= (str[j] - '0') << --bitsCount;
+	for (int i = 0; i < data.size(); ++i) {
+		int len = bitLength(data[i]);
+		maxLength = max(maxLength, len);
+		++lengthFrq[len];
+
+		if (!runs.empty() && runs.back().first == len)
+			++runs.back().second;
+		else
+			runs.push_back({ len, 1 });
+	}
 
-		if (bitsCount <= 0) {
-			compressedData.push_back(byte);
-			byte = 0;
-			bitsCount = 8;
+	// The longest block must fit the longest number, the shorter ones are tried exhaustively
+	int d = max(maxLength, blockLengthsCount);
+	long long bestSize = -1;
+	int blockIdx[MAX_BLOCK_LENGTH + 1];
+
+	for (int a = 1; a < d; ++a) {
+		for (int b = a + 1; b < d; ++b) {
+			for (int c = b + 1; c < d; ++c) {
+				int lengths[4] = { a, b, c, d };
+
+				// Map each bit length to the shortest block that fits it
+				for (int len = 1, k = 0; len <= d; ++len) {
+					while (lengths[k] < len) ++k;
+					blockIdx[len] = k;
+				}
+
+				// Data bits
+				long long bitsCount = 0;
+				for (int len = 1; len <= d; ++len) {
+					bitsCount += lengthFrq[len] * lengths[blockIdx[len]];
+				}
+
+				// Run length encoded sizes bytes, a byte holds at most 63 numbers
+				long long sizesCount = 0;
+				for (int i = 0, runLength = 0; i < runs.size(); ++i) {
+					runLength += runs[i].second;
+
+					if (i + 1 == runs.size() || blockIdx[runs[i + 1].first] != blockIdx[runs[i].first]) {
+						sizesCount += (runLength + 62) / 63;
+						runLength = 0;
+					}
+				}
+
+				long long size = (bitsCount + 7) / 8 + sizesCount;
+				if (bestSize < 0 || size < bestSize) {
+					bestSize = size;
+					copy(lengths, lengths + 4, blockLengths);
+				}
+			}
 		}
 	}
+}
 
-	if (bitsCount < 8) {
-		compressedData.push_back(byte);
+void BitConcatenator::encodeBlockLengths() {
+	// Encode each block length minus one in 5 bits
+	int header = 0;
+	for (int i = 0; i < blockLengthsCount; ++i) {
+		header |= (blockLengths[i] - 1) << (5 * i);
 	}
+
+	compressedData.push_back(header);
+	compressedData.push_back(header >> 8);
+	compressedData.push_back(header >> 16);
 }
 
-void BitConcatenator::encodeBinary(int number) {
-	string bitStr = toBinary(number);
+void BitConcatenator::encodeBinary(BitWriter& writer, int number) {
+	int len = bitLength(number);
 
 	int i;
 
 	for (i = 0; i < blockLengthsCount; ++i)
-		if (bitStr.size() <= blockLengths[i])
+		if (len <= blockLengths[i])
 			break;
 
 	if (i >= blockLengthsCount) {
@@ -55,7 +112,7 @@ void BitConcatenator::encodeBinary(int number) {
 		cerr << "Bit concatenation failed" << endl;
 	}
 
-	dataBitStr += bitStr + string(blockLengths[i] - (int)bitStr.size(), '0');
+	writer.writeBits((unsigned int)number, blockLengths[i]);
 	compressedDataSizes.push_back(i);
 }
 
@@ -84,29 +141,31 @@ void BitConcatenator::encodeDataSizes() {
 
 void BitConcatenator::deconcatenate(vector<uchar>& data, vector<int>& outputData) {
 	// Clear previous data
-	this->dataBitStr.clear();
 	this->compressedData.clear();
 	this->compressedDataSizes.clear();
 
-	// Concatenate data
-	for (int i = 0; i < data.size(); ++i) {
-		dataBitStr += byteToBinaryString(data[i]);
-	}
-
 	// 
 	data.swap(this->compressedData);
 
+	decodeBlockLengths();
 	decodeDataSizes();
 	decodeBitString(outputData);
 }
 
+void BitConcatenator::decodeBlockLengths() {
+	int header = compressedData[0] | (compressedData[1] << 8) | (compressedData[2] << 16);
+	compressedData.erase(compressedData.begin(), compressedData.begin() + 3);
+
+	for (int i = 0; i < blockLengthsCount; ++i) {
+		blockLengths[i] = ((header >> (5 * i)) & 31) + 1;
+	}
+}
+
 void BitConcatenator::decodeBitString(vector<int>& outputData) {
-	for (int i = 0, l = 0; i < compressedDataSizes.size(); ++i) {
-		int dataSize = compressedDataSizes[i];
-		string s = dataBitStr.substr(l, dataSize);
-		int data = toDecimal(s);
-		l += dataSize;
-		outputData.push_back(data);
+	BitReader reader(compressedData.data(), compressedData.size());
+
+	for (int i = 0; i < compressedDataSizes.size(); ++i) {
+		outputData.push_back((int)reader.readBits(compressedDataSizes[i]));
 	}
 }
 
@@ -137,35 +196,12 @@ void BitConcatenator::decodeDataSizes() {
 // Helper functions
 //
 
-string BitConcatenator::toBinary(int number) {
-	if (number == 0) {
-		return "0";
-	}
-
-	string bitStr;
-
-	while (number > 0) {
-		bitStr += '0' + (number & 1);
-		number >>= 1;
-	}
-
-	return bitStr;
-}
-
-int BitConcatenator::toDecimal(string& binary) {
-	int num = 0;
+int BitConcatenator::bitLength(unsigned int number) {
+	int len = 1;
 
-	for (int i = 0; i < binary.size(); ++i) {
-		num |= (binary[i] - '0') << i;
+	while (number >>= 1) {
+		++len;
 	}
 
-	return num;
-}
-
-string BitConcatenator::byteToBinaryString(uchar byte) {
-	string result;
-	for (int i = 7; i >= 0; --i) {
-		result += '0' + (bool)(byte & (1 << i));
-	}
-	return result;
+	return len;
 }
\ No newline at end of file
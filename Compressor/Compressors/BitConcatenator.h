@@ -4,6 +4,7 @@
 #include <stack>
 
 #include "Huffman.h"
+#include "BitStream.h"
 using namespace std;
 
 typedef unsigned char uchar;
@@ -11,10 +12,11 @@ typedef unsigned char uchar;
 class BitConcatenator
 {
 private:
+	static const int MAX_BLOCK_LENGTH = 32;
+
 	int blockLengthsCount = 4;
-	int blockLengths[4] = { 4, 8, 12, 32 };
+	int blockLengths[4] = { 4, 8, 12, 32 };	// Chosen for each concatenated data and stored in its header
 
-	string dataBitStr;
 	vector<uchar> compressedData;
 	vector<int> compressedDataSizes;
 
@@ -26,9 +28,15 @@ public:
 	void concatenate(const vector<int>& data, vector<uchar>& outputData);
 
 private:
-	void encodeBitString(const string& str);
+	/**
+	 * Choose the block lengths that give the minimum concatenated data size,
+	 * the size of each candidate set is computed exactly from the runs of the numbers bit lengths
+	 */
+	void selectBlockLengths(const vector<int>& data);
+
+	void encodeBlockLengths();
 
-	void encodeBinary(int number);
+	void encodeBinary(BitWriter& writer, int number);
 
 	void encodeDataSizes();
 
@@ -40,6 +48,8 @@ public:
 	void deconcatenate(vector<uchar>& data, vector<int>& outputData);
 
 private:
+	void decodeBlockLengths();
+
 	void decodeBitString(vector<int>& outputData);
 
 	void decodeDataSizes();
@@ -49,9 +59,5 @@ private:
 	// Helper functions
 	//
 private:
-	string toBinary(int number);
-
-	int toDecimal(string& binary);
-
-	string byteToBinaryString(uchar byte);
+	int bitLength(unsigned int number);
 };
\ No newline at end of file
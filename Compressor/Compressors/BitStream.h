@@ -0,0 +1,131 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+typedef unsigned char uchar;
+
+/**
+ * Writes bit fields into a vector of bytes, most significant bit first,
+ * using a 64-bit accumulator that is flushed 32 bits at a time
+ */
+class BitWriter
+{
+private:
+	vector<uchar>& outputData;
+	uint64_t bitBuffer = 0;		// Pending bits aligned to the least significant bit
+	int bitsCount = 0;			// Number of pending bits, always less than 32 between calls
+
+public:
+	BitWriter(vector<uchar>& outputData) : outputData(outputData) {}
+
+	/**
+	 * Append the lowest "length" bits of the given value to the stream,
+	 * the value must not have any bits set above "length"
+	 */
+	inline void writeBits(uint64_t value, int length) {
+		if (length > 32) {
+			writeBits(value >> 32, length - 32);
+			value &= 0xFFFFFFFFULL;
+			length = 32;
+		}
+
+		bitBuffer = (bitBuffer << length) | value;
+		bitsCount += length;
+
+		if (bitsCount >= 32) {
+			bitsCount -= 32;
+			uint32_t word = (uint32_t)(bitBuffer >> bitsCount);
+			outputData.push_back(word >> 24);
+			outputData.push_back(word >> 16);
+			outputData.push_back(word >> 8);
+			outputData.push_back(word);
+		}
+	}
+
+	/**
+	 * Write the pending bits padded with zeros to a byte boundary,
+	 * and return the number of padding bits
+	 */
+	inline int flush() {
+		int paddingBits = (8 - (bitsCount & 7)) & 7;
+		writeBits(0, paddingBits);
+
+		while (bitsCount > 0) {
+			bitsCount -= 8;
+			outputData.push_back((uchar)(bitBuffer >> bitsCount));
+		}
+
+		return paddingBits;
+	}
+};
+
+/**
+ * Reads bit fields from a buffer of bytes, most significant bit first,
+ * keeping at least 56 bits available in a 64-bit accumulator;
+ * bits after the end of the buffer are read as zeros
+ */
+class BitReader
+{
+private:
+	const uchar* data;
+	const uchar* dataEnd;
+	uint64_t bitBuffer = 0;		// Next bits of the stream aligned to the most significant bit
+	int bitsCount = 0;			// Number of valid bits in the buffer
+
+public:
+	BitReader(const uchar* data, size_t size) : data(data), dataEnd(data + size) {
+		refill();
+	}
+
+	/**
+	 * Return the next "length" bits (at most 56) without consuming them
+	 */
+	inline uint64_t peekBits(int length) const {
+		return (bitBuffer >> 1) >> (63 - length);
+	}
+
+	/**
+	 * Consume the next "length" bits (at most 56)
+	 */
+	inline void skipBits(int length) {
+		bitBuffer <<= length;
+		bitsCount -= length;
+		refill();
+	}
+
+	/**
+	 * Read and consume the next "length" bits (at most 56)
+	 */
+	inline uint64_t readBits(int length) {
+		uint64_t value = peekBits(length);
+		skipBits(length);
+		return value;
+	}
+
+private:
+	inline void refill() {
+		if (bitsCount >= 56) {
+			return;
+		}
+
+		if (dataEnd - data >= 8) {
+			// Load 8 bytes at once and advance by the whole bytes that fit in the buffer
+			uint64_t word = 0;
+			for (int i = 0; i < 8; ++i) {
+				word = (word << 8) | data[i];
+			}
+
+			bitBuffer |= word >> bitsCount;
+			data += (63 - bitsCount) >> 3;
+			bitsCount |= 56;
+		}
+		else {
+			while (bitsCount <= 56) {
+				uint64_t byte = (data < dataEnd ? *data++ : 0);
+				bitBuffer |= byte << (56 - bitsCount);
+				bitsCount += 8;
+			}
+		}
+	}
+};
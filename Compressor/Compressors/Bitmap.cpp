@@ -0,0 +1,333 @@
+#include "Bitmap.h"
+
+Bitmap::Bitmap(int rows, int cols) : rows(rows), cols(cols) {
+	rowWords = (cols + 63) >> 6;
+	words.assign((size_t)rows * rowWords, 0);
+}
+
+Bitmap::Bitmap(const cv::Mat& mat, uchar backgroundColor) : Bitmap(mat.rows, mat.cols) {
+	for (int i = 0; i < rows; ++i) {
+		const uchar* src = mat.ptr<uchar>(i);
+		uint64_t* dst = ptr(i);
+
+		int w = 0, j = 0;
+
+		// Pack the full words at once
+		for (; j + 64 <= cols; ++w, j += 64) {
+			dst[w] = packPixels(src + j, backgroundColor);
+		}
+
+		// Pack the remaining pixels of the row one at a time
+		for (int b = 0; j < cols; ++j, ++b) {
+			dst[w] |= (uint64_t)(src[j] != backgroundColor) << b;
+		}
+	}
+}
+
+void Bitmap::toMat(cv::Mat& mat, uchar setColor, uchar clearedColor) const {
+	mat = cv::Mat(rows, cols, CV_8U);
+
+	for (int i = 0; i < rows; ++i) {
+		const uint64_t* src = ptr(i);
+		uchar* dst = mat.ptr<uchar>(i);
+
+		for (int j = 0; j < cols; ++j) {
+			dst[j] = ((src[j >> 6] >> (j & 63)) & 1) ? setColor : clearedColor;
+		}
+	}
+}
+
+void Bitmap::appendRows(const Bitmap& other) {
+	if (rows == 0) {
+		*this = other;
+		return;
+	}
+
+	words.insert(words.end(), other.words.begin(), other.words.end());
+	rows += other.rows;
+}
+
+void Bitmap::eraseRows(int count) {
+	words.erase(words.begin(), words.begin() + (size_t)count * rowWords);
+	rows -= count;
+}
+
+Bitmap Bitmap::crop(int startRow, int startCol, int cropRows, int cropCols) const {
+	Bitmap res(cropRows, cropCols);
+	int shift = startCol & 63;
+	uint64_t mask = res.lastWordMask();
+
+	for (int i = 0; i < cropRows; ++i) {
+		const uint64_t* src = ptr(startRow + i) + (startCol >> 6);
+		const uint64_t* srcEnd = ptr(startRow + i) + rowWords;
+		uint64_t* dst = res.ptr(i);
+
+		// Each destination word is made of the high bits of a source word
+		// followed by the low bits of the next one
+		for (int w = 0; w < res.rowWords; ++w, ++src) {
+			uint64_t word = *src >> shift;
+
+			if (shift && src + 1 < srcEnd)
+				word |= src[1] << (64 - shift);
+
+			dst[w] = word;
+		}
+
+		dst[res.rowWords - 1] &= mask;
+	}
+
+	return res;
+}
+
+void Bitmap::paste(const Bitmap& src, int startRow, int startCol) {
+	int shift = startCol & 63;
+	uint64_t srcLastMask = src.lastWordMask();
+
+	for (int i = 0; i < src.rows; ++i) {
+		const uint64_t* srcRow = src.ptr(i);
+		uint64_t* dst = ptr(startRow + i) + (startCol >> 6);
+		uint64_t* dstEnd = ptr(startRow + i) + rowWords;
+
+		// Each source word spans the high bits of a destination word
+		// and the low bits of the next one
+		for (int w = 0; w < src.rowWords; ++w, ++dst) {
+			uint64_t mask = (w + 1 < src.rowWords ? ~0ULL : srcLastMask);
+			uint64_t word = srcRow[w];
+
+			*dst = (*dst & ~(mask << shift)) | (word << shift);
+
+			if (shift && dst + 1 < dstEnd)
+				dst[1] = (dst[1] & ~(mask >> (64 - shift))) | (word >> (64 - shift));
+		}
+	}
+}
+
+int Bitmap::findNext(int row, int col, bool value) const {
+	if (col >= cols) {
+		return cols;
+	}
+
+	const uint64_t* src = ptr(row);
+	int w = col >> 6;
+
+	// Search for a set bit, inverting the words when searching for a cleared pixel,
+	// the padding bits are then found as set so the result is clamped to the columns count
+	uint64_t flip = value ? 0 : ~0ULL;
+	uint64_t word = (src[w] ^ flip) & (~0ULL << (col & 63));
+
+	while (word == 0) {
+		if (++w >= rowWords) {
+			return cols;
+		}
+
+		word = src[w] ^ flip;
+	}
+
+	return min(cols, (w << 6) + countTrailingZeros(word));
+}
+
+int Bitmap::findPrev(int row, int col, bool value) const {
+	if (col < 0) {
+		return -1;
+	}
+
+	const uint64_t* src = ptr(row);
+	int w = col >> 6;
+
+	// Search for a set bit, inverting the words when searching for a cleared pixel
+	uint64_t flip = value ? 0 : ~0ULL;
+	uint64_t word = (src[w] ^ flip) & (~0ULL >> (63 - (col & 63)));
+
+	while (word == 0) {
+		if (--w < 0) {
+			return -1;
+		}
+
+		word = src[w] ^ flip;
+	}
+
+	return (w << 6) + 63 - countLeadingZeros(word);
+}
+
+Bitmap Bitmap::transpose() const {
+	Bitmap res(cols, rows);
+	uint64_t tile[64];
+
+	// Transpose the bitmap a 64x64 bits tile at a time, the tile at the i-th words row
+	// and the w-th words column becomes the tile at the w-th words row and the i-th words column
+	for (int i = 0; i < rows; i += 64) {
+		int tileRows = min(64, rows - i);
+
+		for (int w = 0; w < rowWords; ++w) {
+			for (int k = 0; k < 64; ++k) {
+				tile[k] = (k < tileRows ? ptr(i + k)[w] : 0);
+			}
+
+			transposeTile(tile);
+
+			int tileCols = min(64, cols - (w << 6));
+			for (int k = 0; k < tileCols; ++k) {
+				res.ptr((w << 6) + k)[i >> 6] = tile[k];
+			}
+		}
+	}
+
+	return res;
+}
+
+bool Bitmap::isMirroredLeftRight() const {
+	vector<uint64_t> reversed(rowWords);
+
+	for (int i = 0; i < rows; ++i) {
+		reverseRow(i, reversed.data());
+
+		if (memcmp(reversed.data(), ptr(i), rowWords * sizeof(uint64_t)) != 0)
+			return false;
+	}
+
+	return true;
+}
+
+bool Bitmap::isMirroredTopBottom() const {
+	for (int i = 0, j = rows - 1; i < j; ++i, --j) {
+		if (memcmp(ptr(i), ptr(j), rowWords * sizeof(uint64_t)) != 0)
+			return false;
+	}
+
+	return true;
+}
+
+Bitmap Bitmap::flipLeftRight() const {
+	Bitmap res(rows, cols);
+
+	for (int i = 0; i < rows; ++i) {
+		reverseRow(i, res.ptr(i));
+	}
+
+	return res;
+}
+
+Bitmap Bitmap::flipTopBottom() const {
+	Bitmap res(rows, cols);
+
+	for (int i = 0; i < rows; ++i) {
+		memcpy(res.ptr(rows - 1 - i), ptr(i), rowWords * sizeof(uint64_t));
+	}
+
+	return res;
+}
+
+long long Bitmap::countSet() const {
+	long long cnt = 0;
+
+	for (size_t i = 0; i < words.size(); ++i) {
+		cnt += popCount(words[i]);
+	}
+
+	return cnt;
+}
+
+void Bitmap::invert() {
+	uint64_t mask = lastWordMask();
+
+	for (size_t i = 0; i < words.size(); ++i) {
+		words[i] = ~words[i];
+	}
+
+	// Keep the padding bits cleared
+	for (int i = 0; i < rows && rowWords > 0; ++i) {
+		ptr(i)[rowWords - 1] &= mask;
+	}
+}
+
+uint64_t Bitmap::hash() const {
+	// FNV-1a hash of the dimensions followed by the packed words
+	uint64_t hash = 14695981039346656037ULL;
+	const uint64_t prime = 1099511628211ULL;
+
+	hash = (hash ^ (uint64_t)rows) * prime;
+	hash = (hash ^ (uint64_t)cols) * prime;
+
+	for (size_t i = 0; i < words.size(); ++i) {
+		hash = (hash ^ words[i]) * prime;
+	}
+
+	return hash;
+}
+
+bool Bitmap::operator==(const Bitmap& other) const {
+	if (rows != other.rows || cols != other.cols) {
+		return false;
+	}
+
+	// Compare a word at a time, the padding bits are zeros in both bitmaps
+	for (size_t i = 0; i < words.size(); ++i) {
+		if (words[i] != other.words[i])
+			return false;
+	}
+
+	return true;
+}
+
+uint64_t Bitmap::packPixels(const uchar* pixels, uchar backgroundColor) {
+#if defined(BITMAP_AVX2)
+	__m256i background = _mm256_set1_epi8((char)backgroundColor);
+	uint64_t lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)pixels), background));
+	uint64_t hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(pixels + 32)), background));
+	return ~(lo | (hi << 32));
+#elif defined(BITMAP_SSE2)
+	__m128i background = _mm_set1_epi8((char)backgroundColor);
+	uint64_t word = 0;
+
+	for (int k = 0; k < 4; ++k) {
+		__m128i block = _mm_loadu_si128((const __m128i*)(pixels + 16 * k));
+		word |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, background)) << (16 * k);
+	}
+
+	return ~word;
+#else
+	uint64_t word = 0;
+
+	for (int b = 0; b < 64; ++b) {
+		word |= (uint64_t)(pixels[b] != backgroundColor) << b;
+	}
+
+	return word;
+#endif
+}
+
+void Bitmap::reverseRow(int row, uint64_t* dst) const {
+	const uint64_t* src = ptr(row);
+	int padding = (rowWords << 6) - cols;
+
+	// Reversing the whole words puts the padding bits first,
+	// so the reversed words are shifted down by the padding bits count
+	for (int w = 0; w < rowWords; ++w) {
+		uint64_t lo = reverseBits(src[rowWords - 1 - w]);
+		uint64_t hi = (w + 1 < rowWords ? reverseBits(src[rowWords - 2 - w]) : 0);
+
+		dst[w] = padding ? (lo >> padding) | (hi << (64 - padding)) : lo;
+	}
+}
+
+uint64_t Bitmap::reverseBits(uint64_t word) {
+	word = ((word >> 1) & 0x5555555555555555ULL) | ((word & 0x5555555555555555ULL) << 1);
+	word = ((word >> 2) & 0x3333333333333333ULL) | ((word & 0x3333333333333333ULL) << 2);
+	word = ((word >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((word & 0x0F0F0F0F0F0F0F0FULL) << 4);
+	word = ((word >> 8) & 0x00FF00FF00FF00FFULL) | ((word & 0x00FF00FF00FF00FFULL) << 8);
+	word = ((word >> 16) & 0x0000FFFF0000FFFFULL) | ((word & 0x0000FFFF0000FFFFULL) << 16);
+	return (word >> 32) | (word << 32);
+}
+
+void Bitmap::transposeTile(uint64_t* tile) {
+	// Swap the off-diagonal blocks of halving sizes, starting with the 32x32 blocks
+	uint64_t mask = 0x00000000FFFFFFFFULL;
+
+	for (int j = 32; j != 0; j >>= 1, mask ^= (mask << j)) {
+		for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+			uint64_t t = ((tile[k] >> j) ^ tile[k | j]) & mask;
+			tile[k] ^= t << j;
+			tile[k | j] ^= t;
+		}
+	}
+}
@@ -0,0 +1,227 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// OpenCV libraries
+#include <opencv2/core/core.hpp>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BITMAP_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BITMAP_SSE2
+#endif
+
+using namespace std;
+
+typedef unsigned char uchar;
+
+/**
+ * Binary image packed one bit per pixel, every row starts at a 64-bit word boundary,
+ * column j of a row is the (j % 64)-th bit of its (j / 64)-th word;
+ * the padding bits after the last column of each row are always kept zeros
+ */
+class Bitmap
+{
+public:
+	int rows = 0;
+	int cols = 0;
+	int rowWords = 0;			// Number of 64-bit words per row
+
+private:
+	vector<uint64_t> words;
+
+public:
+	Bitmap() {}
+
+	/**
+	 * Construct a bitmap of the given size with all the pixels cleared
+	 */
+	Bitmap(int rows, int cols);
+
+	/**
+	 * Pack the given 8-bit image, setting the pixels that differ from the given background color
+	 */
+	Bitmap(const cv::Mat& mat, uchar backgroundColor);
+
+	/**
+	 * Unpack the bitmap into an 8-bit image of the given set and cleared pixel colors
+	 */
+	void toMat(cv::Mat& mat, uchar setColor, uchar clearedColor) const;
+
+	/**
+	 * Append the rows of the given bitmap of the same columns count after the last row
+	 */
+	void appendRows(const Bitmap& other);
+
+	/**
+	 * Remove the given number of rows from the top of the bitmap
+	 */
+	void eraseRows(int count);
+
+	/**
+	 * Return a copy of the given sub-rectangle of the bitmap
+	 */
+	Bitmap crop(int startRow, int startCol, int cropRows, int cropCols) const;
+
+	/**
+	 * Copy the given bitmap into this one with its upper left pixel at the given position,
+	 * overwriting all the pixels of the covered rectangle
+	 */
+	void paste(const Bitmap& src, int startRow, int startCol);
+
+	/**
+	 * Return the first column at or after the given one having the given pixel value
+	 * in the given row, or the columns count if there is no such column
+	 */
+	int findNext(int row, int col, bool value) const;
+
+	/**
+	 * Return the last column at or before the given one having the given pixel value
+	 * in the given row, or -1 if there is no such column
+	 */
+	int findPrev(int row, int col, bool value) const;
+
+	/**
+	 * Return the transposed bitmap, the columns of this bitmap become its rows
+	 */
+	Bitmap transpose() const;
+
+	/**
+	 * Check whether each row reads the same from left to right and from right to left
+	 */
+	bool isMirroredLeftRight() const;
+
+	/**
+	 * Check whether each row equals its mirrored row around the middle row
+	 */
+	bool isMirroredTopBottom() const;
+
+	/**
+	 * Return the bitmap mirrored around its vertical axis
+	 */
+	Bitmap flipLeftRight() const;
+
+	/**
+	 * Return the bitmap mirrored around its horizontal axis
+	 */
+	Bitmap flipTopBottom() const;
+
+	/**
+	 * Return the number of set pixels
+	 */
+	long long countSet() const;
+
+	/**
+	 * Invert all the pixels of the bitmap
+	 */
+	void invert();
+
+	/**
+	 * Return a hash of the bitmap dimensions and pixels
+	 */
+	uint64_t hash() const;
+
+	/**
+	 * Check whether the given bitmap has the same size and pixels
+	 */
+	bool operator==(const Bitmap& other) const;
+
+	inline bool get(int row, int col) const {
+		return (words[(size_t)row * rowWords + (col >> 6)] >> (col & 63)) & 1;
+	}
+
+	inline void set(int row, int col) {
+		words[(size_t)row * rowWords + (col >> 6)] |= 1ULL << (col & 63);
+	}
+
+	inline void assign(int row, int col, bool value) {
+		uint64_t& word = words[(size_t)row * rowWords + (col >> 6)];
+		word = (word & ~(1ULL << (col & 63))) | ((uint64_t)value << (col & 63));
+	}
+
+	inline const uint64_t* ptr(int row) const {
+		return words.data() + (size_t)row * rowWords;
+	}
+
+	inline uint64_t* ptr(int row) {
+		return words.data() + (size_t)row * rowWords;
+	}
+
+	/**
+	 * Return the given word of the given row with the bit of each column set
+	 * if its pixel differs from the pixel of the next column in the same row
+	 */
+	inline uint64_t transitions(int row, int w) const {
+		const uint64_t* src = ptr(row);
+		uint64_t next = (w + 1 < rowWords ? src[w + 1] : 0);
+		uint64_t res = src[w] ^ ((src[w] >> 1) | (next << 63));
+
+		// The last column has no next column
+		return (w + 1 < rowWords ? res : res & (lastWordMask() >> 1));
+	}
+
+	/**
+	 * Return the mask of the valid bits in the last word of each row
+	 */
+	inline uint64_t lastWordMask() const {
+		return (cols & 63) ? (1ULL << (cols & 63)) - 1 : ~0ULL;
+	}
+
+	static inline int countTrailingZeros(uint64_t word) {
+#if defined(_MSC_VER)
+		unsigned long idx;
+		_BitScanForward64(&idx, word);
+		return (int)idx;
+#else
+		return __builtin_ctzll(word);
+#endif
+	}
+
+	static inline int countLeadingZeros(uint64_t word) {
+#if defined(_MSC_VER)
+		unsigned long idx;
+		_BitScanReverse64(&idx, word);
+		return 63 - (int)idx;
+#else
+		return __builtin_clzll(word);
+#endif
+	}
+
+	static inline int popCount(uint64_t word) {
+#if defined(_MSC_VER)
+		return (int)__popcnt64(word);
+#else
+		return __builtin_popcountll(word);
+#endif
+	}
+
+private:
+	/**
+	 * Pack the given 64 pixels into a word, setting the bits of the pixels
+	 * that differ from the given background color
+	 */
+	static uint64_t packPixels(const uchar* pixels, uchar backgroundColor);
+
+	/**
+	 * Write the given row of the bitmap with its columns in reverse order into the given words
+	 */
+	void reverseRow(int row, uint64_t* dst) const;
+
+	/**
+	 * Return the given word with its bits in reverse order
+	 */
+	static uint64_t reverseBits(uint64_t word);
+
+	/**
+	 * Transpose the given 64x64 bits tile in place
+	 */
+	static void transposeTile(uint64_t* tile);
+};
@@ -23,6 +23,31 @@ void ByteConcatenator::concatenate(vector<int>& data, vector<uchar>& outputData)
 	outputData.swap(compressedData);
 }
 
+void ByteConcatenator::concatenateStreamVByte(const vector<int>& data, vector<uchar>& outputData) {
+	int n = data.size();
+	int controlBytesCount = (n + 3) / 4;
+
+	// Encode integers count
+	for (int k = 0; k < 4; ++k) {
+		outputData.push_back(n >> (8 * k));
+	}
+
+	int controlIdx = outputData.size();
+	outputData.resize(controlIdx + controlBytesCount, 0);
+
+	// Encode the data bytes in little endian order and their counts in the control bytes
+	for (int i = 0; i < n; ++i) {
+		uint32_t number = data[i];
+		int cnt = 1 + (number > 0xFF) + (number > 0xFFFF) + (number > 0xFFFFFF);
+
+		outputData[controlIdx + i / 4] |= (cnt - 1) << (2 * (i % 4));
+
+		for (int k = 0; k < cnt; ++k) {
+			outputData.push_back(number >> (8 * k));
+		}
+	}
+}
+
 void ByteConcatenator::encodeData() {
 	for (int i = 0; i < rawData.size(); ++i) {
 		encodeToBase256(rawData[i]);
@@ -89,6 +114,44 @@ void ByteConcatenator::deconcatenate(vector<uchar>& data, vector<int>& outputDat
 	outputData.swap(rawData);
 }
 
+void ByteConcatenator::deconcatenateStreamVByte(const vector<uchar>& data, vector<int>& outputData) {
+	// Decode integers count
+	int n = 0;
+	for (int k = 0; k < 4; ++k) {
+		n |= data[k] << (8 * k);
+	}
+
+	int controlBytesCount = (n + 3) / 4;
+	const uchar* control = data.data() + 4;
+	const uchar* dataBytes = control + controlBytesCount;
+#ifdef BYTE_CONCATENATOR_SIMD
+	const uchar* dataEnd = data.data() + data.size();
+#endif
+
+	int offset = outputData.size();
+	outputData.resize(offset + n);
+	uint32_t* output = (uint32_t*)(outputData.data() + offset);
+
+	for (int i = 0; i < controlBytesCount; ++i) {
+		int count = min(4, n - 4 * i);
+
+#ifdef BYTE_CONCATENATOR_SIMD
+		// Expand the group bytes to 4 integers at once while 16 bytes can be safely loaded
+		if (count == 4 && dataEnd - dataBytes >= 16) {
+			uchar c = control[i];
+			__m128i bytes = _mm_loadu_si128((const __m128i*)dataBytes);
+			__m128i mask = _mm_loadu_si128((const __m128i*)(getShuffleTable() + 16 * c));
+			_mm_storeu_si128((__m128i*)(output + 4 * i), _mm_shuffle_epi8(bytes, mask));
+
+			dataBytes += 4 + (c & 3) + ((c >> 2) & 3) + ((c >> 4) & 3) + (c >> 6);
+			continue;
+		}
+#endif
+
+		dataBytes += decodeGroup(control[i], dataBytes, output + 4 * i, count);
+	}
+}
+
 void ByteConcatenator::decodeData() {
 	for (int i = 0; i < compressedDataSizes.size(); ++i) {
 		rawData.push_back(decodeFromBase256());
@@ -117,6 +180,51 @@ void ByteConcatenator::decodeDataSizes() {
 	}
 }
 
+int ByteConcatenator::decodeGroup(uchar control, const uchar* dataBytes, uint32_t* output, int count) {
+	int bytesCnt = 0;
+
+	for (int k = 0; k < count; ++k) {
+		int cnt = ((control >> (2 * k)) & 3) + 1;
+		uint32_t number = 0;
+
+		for (int j = cnt - 1; j >= 0; --j) {
+			number = (number << 8) | dataBytes[bytesCnt + j];
+		}
+
+		output[k] = number;
+		bytesCnt += cnt;
+	}
+
+	return bytesCnt;
+}
+
+const uchar* ByteConcatenator::getShuffleTable() {
+	// Built once on the first call
+	static const struct ShuffleTable {
+		uchar masks[256 * 16];
+
+		ShuffleTable() {
+			for (int control = 0; control < 256; ++control) {
+				uchar* mask = masks + 16 * control;
+				int src = 0;
+
+				for (int k = 0; k < 4; ++k) {
+					int cnt = ((control >> (2 * k)) & 3) + 1;
+
+					// Copy the integer bytes and zero the rest (a mask byte with the high bit set)
+					for (int j = 0; j < 4; ++j) {
+						mask[4 * k + j] = (j < cnt ? src + j : 0x80);
+					}
+
+					src += cnt;
+				}
+			}
+		}
+	} table;
+
+	return table.masks;
+}
+
 int ByteConcatenator::decodeFromBase256() {
 	int size = compressedDataSizes[sizesIdx++];
 	int idx = size + bytesIdx;
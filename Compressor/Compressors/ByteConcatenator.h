@@ -4,6 +4,13 @@
 #include <vector>
 #include <stack>
 #include <map>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#include <tmmintrin.h>
+#define BYTE_CONCATENATOR_SIMD
+#endif
 
 using namespace std;
 
@@ -25,6 +32,13 @@ private:
 public:
 	void concatenate(vector<int>& data, vector<uchar>& outputData);
 
+	/**
+	 * Concatenate the given integers in Stream VByte layout, the integers count is followed
+	 * by a control byte for each group of 4 integers holding their bytes counts,
+	 * then by the data bytes of all integers
+	 */
+	void concatenateStreamVByte(const vector<int>& data, vector<uchar>& outputData);
+
 private:
 	void encodeData();
 
@@ -39,10 +53,28 @@ private:
 public:
 	void deconcatenate(vector<uchar>& data, vector<int>& outputData);
 
+	/**
+	 * De-concatenate integers stored in Stream VByte layout, each group of 4 integers
+	 * is expanded by a single byte shuffle when SSSE3 is available
+	 */
+	void deconcatenateStreamVByte(const vector<uchar>& data, vector<int>& outputData);
+
 private:
 	void decodeData();
 
 	void decodeDataSizes();
 
 	int decodeFromBase256();
+
+	/**
+	 * Decode the group of integers described by the given control byte
+	 * and return the number of data bytes it used
+	 */
+	int decodeGroup(uchar control, const uchar* dataBytes, uint32_t* output, int count);
+
+	/**
+	 * Return the shuffle masks that expand the data bytes of a group
+	 * to 4 integers for each control byte
+	 */
+	static const uchar* getShuffleTable();
 };
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+typedef unsigned char uchar;
+
+/**
+ * Append the given integer in 4 little-endian bytes
+ */
+inline void writeInt(vector<uchar>& outputBytes, uint32_t value) {
+	for (int i = 0; i < 4; ++i) {
+		outputBytes.push_back((value >> (8 * i)) & 255);
+	}
+}
+
+/**
+ * Read an integer stored in 4 little-endian bytes at the given position and advance it,
+ * the caller checks that the 4 bytes are available
+ */
+inline uint32_t readInt(const vector<uchar>& inputBytes, size_t& idx) {
+	uint32_t value = 0;
+	for (int i = 0; i < 4; ++i) {
+		value |= (uint32_t)inputBytes[idx++] << (8 * i);
+	}
+	return value;
+}
@@ -6,6 +6,54 @@
 
 void Compressor::compress(const cv::Mat& imageMat, vector<uchar>& outputBytes) {
 	// Clear previous records
+	clearRecords();
+
+	// Pass data to compressor object
+	this->imageMat = imageMat;
+	this->imageBits = Bitmap(imageMat, 0);
+	this->imageRows = imageMat.rows;
+	this->imageCols = imageMat.cols;
+
+	// Detecting dominant color must come before detecting image blocks
+	detectDominantColor();
+	detectImageBlocks();
+
+	// Encode image
+	encodeImage(outputBytes);
+}
+
+void Compressor::compress(RowSource& source, vector<uchar>& outputBytes) {
+	// Clear previous records
+	clearRecords();
+
+	// Detect the image blocks reading the image rows in stripes
+	if (!detectImageBlocks(source)) {
+		clearRecords();
+		return;
+	}
+
+	// Encode image
+	encodeImage(outputBytes);
+}
+
+void Compressor::compress(const ImageDetection& detection, vector<uchar>& outputBytes) {
+	// Clear previous records
+	clearRecords();
+
+	// Restore the detected image records
+	this->imageRows = detection.rows;
+	this->imageCols = detection.cols;
+	this->dominantColor = detection.dominantColor;
+	this->blockColor = 255 - detection.dominantColor;
+	this->shapes = detection.shapes;
+	this->shapeBlocks = detection.shapeBlocks;
+	this->imageBlocks = detection.imageBlocks;
+
+	// Encode image
+	encodeImage(outputBytes);
+}
+
+void Compressor::clearRecords() {
 	dataIdx = 0;
 	this->compressedData.clear();
 	this->concatenatedData.clear();
@@ -13,214 +61,527 @@ void Compressor::compress(const cv::Mat& imageMat, vector<uchar>& outputBytes) {
 	this->shapeBlocks.clear();
 	this->imageBlocks.clear();
 	this->blockShapes.clear();
+	this->shapesIndex.clear();
+	this->shapeFirstPixels.clear();
+	this->sharedShapeIds.clear();
+	sharedShapesCount = 0;
+}
 
-	// Pass data to compressor object
-	this->imageMat = imageMat;
-
-	// Encode image
-	encodeAdvanced();
-
+void Compressor::encodeOutput(vector<uchar>& outputBytes) {
 	// Concatenate compressed data bits
 	ByteConcatenator concat;
-	concat.concatenate(this->compressedData, this->concatenatedData);
+	if (streamVByte)
+		concat.concatenateStreamVByte(this->compressedData, this->concatenatedData);
+	else
+		concat.concatenate(this->compressedData, this->concatenatedData);
 
 	// Encode compression meta-data
 	encodeMetaData();
 
-	// Encode the compressed image using Huffman encoding algorithm
-	Huffman huffman;
-	huffman.encode(this->concatenatedData, outputBytes);
+	// Encode the compressed image using the selected entropy coder
+	encodeEntropy(outputBytes);
 }
 
-void Compressor::encodeAdvanced() {
-	// Store image rows & cols count
-	compressedData.push_back(imageMat.rows);
-	compressedData.push_back(imageMat.cols);
+void Compressor::setHuffmanStreamsCount(int count) {
+	huffmanStreamsCount = count;
+}
+
+void Compressor::setEntropyCoder(EntropyCoder coder) {
+	entropyCoder = coder;
+}
+
+void Compressor::setStreamVByte(bool enabled) {
+	streamVByte = enabled;
+}
+
+void Compressor::setThreadsCount(int count) {
+	threadsCount = max(1, count);
+}
+
+void Compressor::setThreadPool(ThreadPool* pool) {
+	threadPool = pool;
+}
+
+void Compressor::setShapeSymmetry(bool enabled) {
+	shapeSymmetry = enabled;
+}
+
+void Compressor::setSpatialIndex(bool enabled) {
+	spatialIndex = enabled;
+}
+
+void Compressor::setDictionary(const ShapeDictionary* dictionary) {
+	this->dictionary = dictionary;
+}
+
+bool Compressor::selectDictionary(uint32_t id) {
+	unordered_map<uint32_t, ShapeDictionary>::const_iterator it = loadedDictionaries.find(id);
+
+	if (it == loadedDictionaries.end()) {
+		return false;
+	}
+
+	dictionary = &it->second;
+	return true;
+}
+
+uint32_t Compressor::loadDictionary(vector<uchar>& dictionaryBytes) {
+	ShapeDictionary loaded;
+	extractDictionary(dictionaryBytes, loaded);
+
+	// Keep the already loaded dictionary as it may be in use
+	uint32_t id = loaded.getId();
+	if (loadedDictionaries.find(id) == loadedDictionaries.end())
+		loadedDictionaries[id] = loaded;
+
+	return id;
+}
+
+void Compressor::trainDictionary(const vector<cv::Mat>& samples, int maxShapes, ShapeDictionary& outputDictionary) {
+	ShapeDictionary candidates;
+	vector<long long> frequency;            // Number of blocks refering to each candidate shape
+
+	for (int i = 0; i < samples.size(); ++i) {
+		vector<Bitmap> sampleShapes;
+		vector<int> blocksCount;
+		detectShapes(samples[i], sampleShapes, blocksCount);
+
+		for (int j = 0; j < sampleShapes.size(); ++j) {
+			int idx = candidates.add(sampleShapes[j]);
+
+			if (idx == frequency.size())
+				frequency.push_back(0);
+			frequency[idx] += blocksCount[j];
+		}
+	}
+
+	// Keep the most frequent shapes, the earlier found shape wins ties
+	vector<pair<long long, int>> order;
+	for (int i = 0; i < frequency.size(); ++i) {
+		if (frequency[i] > 1)
+			order.push_back(make_pair(-frequency[i], i));
+	}
+
+	sort(order.begin(), order.end());
+	order.resize(min((int)order.size(), max(0, maxShapes)));
+
+	outputDictionary = ShapeDictionary();
+	for (int i = 0; i < order.size(); ++i) {
+		outputDictionary.add(candidates.shapes[order[i].second]);
+	}
+	outputDictionary.updateId();
+}
+
+void Compressor::compressDictionary(const ShapeDictionary& dictionary, vector<uchar>& outputBytes) {
+	// Clear previous records
+	clearRecords();
+	useDictionary = false;
+	widePositions = false;
+
+	// Store the dictionary identifier followed by its shapes, having no refering blocks
+	compressedData.push_back(dictionary.getId());
+	shapes = dictionary.shapes;
+	shapeBlocks.resize(shapes.size());
+
+	encodeDistinctShapes();
+	encodeOutput(outputBytes);
+}
+
+void Compressor::detectShapes(const cv::Mat& imageMat, vector<Bitmap>& detectedShapes, vector<int>& blocksCount) {
+	// Clear previous records
+	clearRecords();
+
+	this->imageMat = imageMat;
+	this->imageBits = Bitmap(imageMat, 0);
 
-	// Detecting dominant color must come before detecting image blocks
 	detectDominantColor();
 	detectImageBlocks();
 
+	detectedShapes = shapes;
+	blocksCount.resize(shapes.size());
+	for (int i = 0; i < shapes.size(); ++i) {
+		blocksCount[i] = shapeBlocks[i].size();
+	}
+}
+
+void Compressor::detect(const cv::Mat& imageMat, ImageDetection& detection) {
+	// Clear previous records
+	clearRecords();
+
+	this->imageMat = imageMat;
+	this->imageBits = Bitmap(imageMat, 0);
+
+	detectDominantColor();
+	detectImageBlocks();
+
+	// Pass the detected records to function caller
+	detection.rows = imageMat.rows;
+	detection.cols = imageMat.cols;
+	detection.dominantColor = dominantColor;
+	swap(detection.shapes, shapes);
+	swap(detection.shapeBlocks, shapeBlocks);
+	swap(detection.imageBlocks, imageBlocks);
+}
+
+void Compressor::encodeImage(vector<uchar>& outputBytes) {
+	widePositions = ((long long)imageRows * imageCols > INT_MAX);
+	useDictionary = (dictionary != NULL);
+
+	// Refer to the shapes shared with other images before encoding the image own shapes
+	if (useDictionary)
+		mapSharedShapes();
+
+	if (spatialIndex) {
+		encodeTiles(outputBytes);
+	}
+	else {
+		encodeAdvanced();
+		encodeOutput(outputBytes);
+	}
+}
+
+void Compressor::encodeAdvanced() {
+	// Store image rows & cols count
+	compressedData.push_back(imageRows);
+	compressedData.push_back(imageCols);
+
+	if (useDictionary)
+		encodeSharedShapes(true);
+
 	// Encode shape definition and image blocks indecies
 	encodeDistinctShapes();
 	encodeImageBlocks();
 }
 
-void Compressor::encodeDistinctShapes() {
-	vector<int> encodedShapes;
+void Compressor::encodeTiles(vector<uchar>& outputBytes) {
+	int tileRows = SPATIAL_INDEX_TILE_ROWS;
+	int tilesCount = (imageRows + tileRows - 1) / tileRows;
+	int shapesCount = (int)shapes.size() - sharedShapesCount;
+	int chunksCount = (shapesCount + SPATIAL_INDEX_CHUNK_SHAPES - 1) / SPATIAL_INDEX_CHUNK_SHAPES;
+	vector<vector<uchar>> units;
 
-	// Encode image distinct shapes
-	compressedData.push_back(shapes.size());
-	for (int i = 0; i < shapes.size(); ++i) {
-		//
-		// Try different run length encoding techniques and pick the better one
-		//
-		vector<pair<vector<int>, int>> vec(4);
+	vector<vector<int>> encodedShapes;
+	vector<int> shapesEncodingType;
+	encodeShapesPixels(encodedShapes, shapesEncodingType);
+
+	// Encode the header unit holding the shared shapes followed by the size
+	// and encoding type of each shape, needed to locate the blocks of a region
+	compressedData.clear();
+	if (useDictionary)
+		encodeSharedShapes(false);
+
+	compressedData.push_back(shapesCount);
+	for (int i = sharedShapesCount; i < shapes.size(); ++i) {
+		compressedData.push_back(shapes[i].rows);
+		compressedData.push_back(shapes[i].cols);
+		compressedData.push_back(shapesEncodingType[i]);
+	}
 
-		encodeRunLengthHorizontal(shapes[i], vec[0].first);
-		vec[0].second = RUN_LENGTH_HOR;
-		encodeRunLengthVertical(shapes[i], vec[1].first);
-		vec[1].second = RUN_LENGTH_VER;
-		encodeRunLengthSpiral(shapes[i], vec[2].first);
-		vec[2].second = RUN_LENGTH_SPIRAL;
-		encodeRunLengthZigZag(shapes[i], vec[3].first);
-		vec[3].second = RUN_LENGTH_ZIGZAG;
+	units.push_back(vector<uchar>());
+	encodeUnit(units.back());
 
-		sort(vec.begin(), vec.end(), cmp);
+	// Encode the pixels of each chunk of shapes in its own unit
+	for (int k = 0; k < chunksCount; ++k) {
+		int first = sharedShapesCount + k * SPATIAL_INDEX_CHUNK_SHAPES;
+		int last = min((int)shapes.size(), first + SPATIAL_INDEX_CHUNK_SHAPES);
 
-		encodedShapes.insert(encodedShapes.end(), vec[0].first.begin(), vec[0].first.end());
+		compressedData.clear();
+		for (int i = first; i < last; ++i) {
+			compressedData.insert(compressedData.end(), encodedShapes[i].begin() + 2, encodedShapes[i].end());
+		}
 
-		if (i & 1)
-			compressedData.back() |= vec[0].second << 2;
-		else
-			compressedData.push_back(vec[0].second);
+		units.push_back(vector<uchar>());
+		encodeUnit(units.back());
+	}
 
-		// Encode indecies of blocks refering to the i-th shape in relative order
-		encodedShapes.push_back(shapeBlocks[i].size());
-		for (int j = 0, prv = 0; j < shapeBlocks[i].size(); ++j) {
-			encodedShapes.push_back(shapeBlocks[i][j] - prv);
-			prv = shapeBlocks[i][j];
+	// Encode the blocks starting in each tile of rows in its own unit, each block is stored
+	// by its shape and its start pixel relative to the previous block or to the tile start,
+	// and find the earliest tile having blocks reaching each tile
+	vector<int> reach(tilesCount + 1, tilesCount);
+
+	for (int t = 0, idx = 0; t < tilesCount; ++t) {
+		long long prv = (long long)t * tileRows * imageCols;
+		int blocksCount = 0;
+
+		compressedData.assign(1, 0);
+		for (; idx < imageBlocks.size() && imageBlocks[idx].first / imageCols < (long long)(t + 1) * tileRows; ++idx, ++blocksCount) {
+			long long offset = imageBlocks[idx].first - prv;
+			int lastRow = imageBlocks[idx].first / imageCols + shapes[imageBlocks[idx].second].rows - 1;
+
+			compressedData.push_back(imageBlocks[idx].second);
+			if (widePositions)
+				compressedData.push_back(offset >> 31);
+			compressedData.push_back(offset & INT_MAX);
+
+			reach[lastRow / tileRows] = min(reach[lastRow / tileRows], t);
+			prv = imageBlocks[idx].first;
 		}
+		compressedData[0] = blocksCount;
+
+		units.push_back(vector<uchar>());
+		encodeUnit(units.back());
+	}
+
+	for (int t = tilesCount - 1; t >= 0; --t) {
+		reach[t] = min(reach[t], min(reach[t + 1], t));
 	}
 
-	// Insert encoded shapes
-	compressedData.insert(compressedData.end(), encodedShapes.begin(), encodedShapes.end());
+	// Store the file mark, the image and tiles sizes, the units sizes and the tiles reach
+	// outside the entropy coded units, followed by the units
+	outputBytes.push_back(TILED_FILE_MARK);
+	writeInt(outputBytes, imageRows);
+	writeInt(outputBytes, imageCols);
+	writeInt(outputBytes, tileRows);
+	writeInt(outputBytes, tilesCount);
+	writeInt(outputBytes, SPATIAL_INDEX_CHUNK_SHAPES);
+	writeInt(outputBytes, chunksCount);
+
+	for (int i = 0; i < units.size(); ++i) {
+		writeInt(outputBytes, units[i].size());
+	}
+	for (int t = 0; t < tilesCount; ++t) {
+		writeInt(outputBytes, reach[t]);
+	}
+	for (int i = 0; i < units.size(); ++i) {
+		outputBytes.insert(outputBytes.end(), units[i].begin(), units[i].end());
+	}
 }
 
-void Compressor::applySymmetry(cv::Mat& img) {
-	int n = img.rows / 2;
-	int m = img.cols / 2;
+void Compressor::encodeUnit(vector<uchar>& outputBytes) {
+	concatenatedData.clear();
+	encodeOutput(outputBytes);
+}
 
-	bool horFlag = true;
-	bool verFlag = true;
-	
-	// Check for symmetry around horizontal axis
-	for (int i = 0; i < n; ++i) {
-		for (int j = 0; j < img.cols; ++j) {
-			if (img.at<uchar>(i, j) != img.at<uchar>(img.rows - i - 1, j)) {
-				horFlag = false;
-				break;
-			}
-		}
+void Compressor::encodeDistinctShapes() {
+	vector<vector<int>> encodedShapes;
+	vector<int> shapesEncodingType;
+	int shapesCount = (int)shapes.size() - sharedShapesCount;
 
-		if (!horFlag) {
-			break;
-		}
+	encodeShapesPixels(encodedShapes, shapesEncodingType);
+
+	// Encode image distinct shapes count and encoding types, the symmetry
+	// of each shape is stored next to its type when the symmetry is enabled
+	int typeBits = (shapeSymmetry ? 4 : 2);
+
+	compressedData.push_back(shapesCount);
+	for (int i = 0; i < shapesCount; ++i) {
+		if (i & 1)
+			compressedData.back() |= shapesEncodingType[sharedShapesCount + i] << typeBits;
+		else
+			compressedData.push_back(shapesEncodingType[sharedShapesCount + i]);
 	}
 
-	// Check for symmetry around vertical axis
-	for (int j = 0; j < m; ++j) {
-		for (int i = 0; i < img.rows; ++i) {
-			if (img.at<uchar>(i, j) != img.at<uchar>(i, img.cols - j - 1)) {
-				verFlag = false;
-				break;
-			}
-		}
+	// Insert encoded shapes in order, each followed by the indecies
+	// of its refering blocks in relative order
+	for (int i = sharedShapesCount; i < shapes.size(); ++i) {
+		compressedData.insert(compressedData.end(), encodedShapes[i].begin(), encodedShapes[i].end());
 
-		if (!verFlag) {
-			break;
+		compressedData.push_back(shapeBlocks[i].size());
+		for (int j = 0, prv = 0; j < shapeBlocks[i].size(); ++j) {
+			compressedData.push_back(shapeBlocks[i][j] - prv);
+			prv = shapeBlocks[i][j];
 		}
 	}
+}
 
-	n = img.rows;
-	m = img.cols;
+void Compressor::encodeShapesPixels(vector<vector<int>>& encodedShapes, vector<int>& shapesEncodingType) {
+	int shapesCount = (int)shapes.size() - sharedShapesCount;
 
-	if (horFlag && verFlag) {
-		cout << ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> HOR & VER" << endl;
-		n = img.rows / 2 + (img.rows & 1);
-		m = img.cols / 2 + (img.cols & 1);
-	}
-	else if (horFlag) {
-		cout << ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> HOR" << endl;
-		n = img.rows / 2 + (img.rows & 1);
+	encodedShapes.assign(shapes.size(), vector<int>());
+	shapesEncodingType.assign(shapes.size(), 0);
+
+	// Encode the shapes independently on the worker threads, each one taking the next
+	// unclaimed shape, the results are stored by shape index to keep the output deterministic;
+	// the shared shapes are already encoded by their dictionary indecies
+	int workersCount = max(1, min(threadsCount, shapesCount / MIN_WORKER_SHAPES));
+	atomic<int> nextShape(sharedShapesCount);
+
+	runParallel(workersCount, [&](int) {
+		encodeShapes(nextShape, encodedShapes, shapesEncodingType);
+	});
+}
+
+void Compressor::runParallel(int count, function<void(int)> task) {
+	if (count == 1) {
+		task(0);
 	}
-	else if (verFlag) {
-		cout << ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> VER" << endl;
-		m = img.cols / 2 + (img.cols & 1);
+	else if (threadPool != NULL) {
+		threadPool->parallelFor(count, task);
 	}
 	else {
-		return;
+		vector<thread> workers;
+		for (int i = 0; i < count; ++i) {
+			workers.push_back(thread(task, i));
+		}
+		for (int i = 0; i < count; ++i) {
+			workers[i].join();
+		}
 	}
-
-	cv::Mat shape(img, Range(0, n), Range(0, m));
-	img = shape;
 }
 
-void Compressor::encodeImageBlocks() {
-	// Encode image blocks starting pixels (upper left pixels)
-	for (int i = 0, prv = 0; i < imageBlocks.size(); ++i) {
-		compressedData.push_back(imageBlocks[i].first - prv);
-		prv = imageBlocks[i].first;// +shapes[imageBlocks[i].second].cols / 1.65;
+void Compressor::encodeSharedShapes(bool withBlocks) {
+	compressedData.push_back(dictionary->getId());
+	compressedData.push_back(sharedShapesCount);
+
+	for (int i = 0, prv = 0; i < sharedShapesCount; ++i) {
+		// Encode the dictionary index of the i-th shape in relative order
+		compressedData.push_back(sharedShapeIds[i] - prv);
+		prv = sharedShapeIds[i];
+
+		if (!withBlocks)
+			continue;
+
+		// Encode indecies of blocks refering to the i-th shape in relative order
+		compressedData.push_back(shapeBlocks[i].size());
+		for (int j = 0, prvBlock = 0; j < shapeBlocks[i].size(); ++j) {
+			compressedData.push_back(shapeBlocks[i][j] - prvBlock);
+			prvBlock = shapeBlocks[i][j];
+		}
 	}
 }
 
-void Compressor::encodeRunLengthHorizontal(const cv::Mat& img, vector<int>& encodedData) {
-	// Store image rows & cols count
-	encodedData.push_back(img.rows);
-	encodedData.push_back(img.cols);
+void Compressor::encodeShapes(atomic<int>& nextShape, vector<vector<int>>& encodedShapes, vector<int>& shapesEncodingType) {
+	for (int i = nextShape++; i < shapes.size(); i = nextShape++) {
+		// Store shape rows & cols count
+		encodedShapes[i].push_back(shapes[i].rows);
+		encodedShapes[i].push_back(shapes[i].cols);
 
-	// Store image pixels
-	int dir = 1;
-	int initVal = 0;
-	int runCnt = 0;
-	bool pixel, prvColor = true;
+		// Only encode the upper and/or left part of the symmetric shapes,
+		// the other shapes are encoded in place without copying them
+		int symmetry = (shapeSymmetry ? detectSymmetry(shapes[i]) : SYMMETRY_NONE);
+		Bitmap foldedShape;
+		if (symmetry != SYMMETRY_NONE)
+			foldedShape = foldShape(shapes[i], symmetry);
+		const Bitmap& shape = (symmetry == SYMMETRY_NONE ? shapes[i] : foldedShape);
 
-	for (int i = 0; i < img.rows; ++i) {
-		for (int j = initVal; j >= 0 && j < img.cols; j += dir) {
-			pixel = (img.at<uchar>(i, j) == dominantColor);
+		//
+		// Count the runs of the different run length encoding techniques
+		// and encode using the one having the fewest runs, the earlier type wins ties
+		//
+		int runsCount[4];
 
-			if (prvColor == pixel) {
-				++runCnt;
-			}
-			else {
-				encodedData.push_back(runCnt);
-				runCnt = 1;
-				prvColor = pixel;
-			}
+		countRunsHorizontalVertical(shape, runsCount[RUN_LENGTH_HOR], runsCount[RUN_LENGTH_VER]);
+		runsCount[RUN_LENGTH_SPIRAL] = countRunsSpiral(shape);
+		runsCount[RUN_LENGTH_ZIGZAG] = countRunsZigZag(shape);
+
+		int type = RUN_LENGTH_HOR;
+		for (int t = 1; t < 4; ++t) {
+			if (runsCount[t] < runsCount[type])
+				type = t;
 		}
 
-		dir = -dir;
-		initVal = img.cols - 1 - initVal;
+		if (type == RUN_LENGTH_HOR)
+			encodeRunLengthHorizontal(shape, encodedShapes[i]);
+		else if (type == RUN_LENGTH_VER)
+			encodeRunLengthVertical(shape, encodedShapes[i]);
+		else if (type == RUN_LENGTH_SPIRAL)
+			encodeRunLengthSpiral(shape, encodedShapes[i]);
+		else if (type == RUN_LENGTH_ZIGZAG)
+			encodeRunLengthZigZag(shape, encodedShapes[i]);
+
+		shapesEncodingType[i] = type | (symmetry << 2);
 	}
-	encodedData.push_back(runCnt);
 }
 
-void Compressor::encodeRunLengthVertical(const cv::Mat& img, vector<int>& encodedData) {
-	// Store image rows & cols count
-	encodedData.push_back(img.rows);
-	encodedData.push_back(img.cols);
+int Compressor::detectSymmetry(const Bitmap& shape) {
+	int symmetry = SYMMETRY_NONE;
 
+	if (shape.rows > 1 && shape.isMirroredTopBottom())
+		symmetry |= SYMMETRY_HOR;
+	if (shape.cols > 1 && shape.isMirroredLeftRight())
+		symmetry |= SYMMETRY_VER;
+
+	return symmetry;
+}
+
+Bitmap Compressor::foldShape(const Bitmap& shape, int symmetry) {
+	int rows = (symmetry & SYMMETRY_HOR) ? (shape.rows + 1) / 2 : shape.rows;
+	int cols = (symmetry & SYMMETRY_VER) ? (shape.cols + 1) / 2 : shape.cols;
+
+	return shape.crop(0, 0, rows, cols);
+}
+
+Bitmap Compressor::unfoldShape(const Bitmap& part, int rows, int cols, int symmetry) {
+	Bitmap shape(rows, cols);
+	shape.paste(part, 0, 0);
+
+	// Mirror the left part to the right then the upper part to the bottom,
+	// the middle row and column of odd sizes are pasted twice with the same pixels
+	if (symmetry & SYMMETRY_VER) {
+		shape.paste(part.flipLeftRight(), 0, cols - part.cols);
+	}
+	if (symmetry & SYMMETRY_HOR) {
+		Bitmap upper = shape.crop(0, 0, part.rows, cols);
+		shape.paste(upper.flipTopBottom(), rows - part.rows, 0);
+	}
+
+	return shape;
+}
+
+void Compressor::encodeImageBlocks() {
+	// Encode image blocks starting pixels (upper left pixels), the offsets
+	// are split into two integers of 31 bits for images of too many pixels
+	long long prv = 0;
+
+	for (int i = 0; i < imageBlocks.size(); ++i) {
+		long long offset = imageBlocks[i].first - prv;
+
+		if (widePositions)
+			compressedData.push_back(offset >> 31);
+		compressedData.push_back(offset & INT_MAX);
+
+		prv = imageBlocks[i].first;// +shapes[imageBlocks[i].second].cols / 1.65;
+	}
+}
+
+void Compressor::encodeRunLengthHorizontal(const Bitmap& img, vector<int>& encodedData) {
 	// Store image pixels
-	int dir = 1;
-	int initVal = 0;
-	int runCnt = 0;
-	bool pixel, prvColor = true;
+	encodeRunLengthSerpentine(img, encodedData);
+}
 
-	for (int j = 0; j < img.cols; ++j) {
-		for (int i = initVal; i >= 0 && i < img.rows; i += dir) {
-			pixel = (img.at<uchar>(i, j) == dominantColor);
+void Compressor::encodeRunLengthVertical(const Bitmap& img, vector<int>& encodedData) {
+	// Store image pixels, the columns of the image are the rows of its transpose
+	encodeRunLengthSerpentine(img.transpose(), encodedData);
+}
+
+void Compressor::encodeRunLengthSerpentine(const Bitmap& img, vector<int>& encodedData) {
+	int runCnt = 0;
+	bool color = false;
 
-			if (prvColor == pixel) {
-				++runCnt;
+	for (int i = 0; i < img.rows; ++i) {
+		// Jump to the end of each run searching the rows words, even rows
+		// are traversed from left to right and odd rows from right to left
+		if ((i & 1) == 0) {
+			for (int j = 0; j < img.cols; ) {
+				int runEnd = img.findNext(i, j, !color);
+				runCnt += runEnd - j;
+				j = runEnd;
+
+				if (j < img.cols) {
+					encodedData.push_back(runCnt);
+					runCnt = 0;
+					color = !color;
+				}
 			}
-			else {
-				encodedData.push_back(runCnt);
-				runCnt = 1;
-				prvColor = pixel;
+		}
+		else {
+			for (int j = img.cols - 1; j >= 0; ) {
+				int runEnd = img.findPrev(i, j, !color);
+				runCnt += j - runEnd;
+				j = runEnd;
+
+				if (j >= 0) {
+					encodedData.push_back(runCnt);
+					runCnt = 0;
+					color = !color;
+				}
 			}
 		}
-
-		dir = -dir;
-		initVal = img.rows - 1 - initVal;
 	}
 	encodedData.push_back(runCnt);
 }
 
-void Compressor::encodeRunLengthSpiral(const cv::Mat& img, vector<int>& encodedData) {
-	// Store image rows & cols count
-	encodedData.push_back(img.rows);
-	encodedData.push_back(img.cols);
-
+void Compressor::encodeRunLengthSpiral(const Bitmap& img, vector<int>& encodedData) {
 	// Store image pixels
 	int i = 0, j = img.cols - 1;
 	int up = 0, down = img.rows - 1, left = 0, right = img.cols - 1;
@@ -232,7 +593,7 @@ void Compressor::encodeRunLengthSpiral(const cv::Mat& img, vector<int>& encodedD
 	bool pixel, prvColor = true;
 
 	while (cellsVisCount++ < cellsCount) {
-		pixel = (img.at<uchar>(i, j) == dominantColor);
+		pixel = !img.get(i, j);
 
 		if (prvColor == pixel) {
 			++runCnt;
@@ -270,11 +631,7 @@ void Compressor::encodeRunLengthSpiral(const cv::Mat& img, vector<int>& encodedD
 	encodedData.push_back(runCnt);
 }
 
-void Compressor::encodeRunLengthZigZag(const cv::Mat& img, vector<int>& encodedData) {
-	// Store image rows & cols count
-	encodedData.push_back(img.rows);
-	encodedData.push_back(img.cols);
-
+void Compressor::encodeRunLengthZigZag(const Bitmap& img, vector<int>& encodedData) {
 	// Store image pixels
 	int i = img.rows - 1, j = img.cols - 1;
 	int cellsVisCount = 0, cellsCount = img.rows * img.cols;
@@ -285,7 +642,7 @@ void Compressor::encodeRunLengthZigZag(const cv::Mat& img, vector<int>& encodedD
 	bool pixel, prvColor = true;
 
 	while (cellsVisCount++ < cellsCount) {
-		pixel = (img.at<uchar>(i, j) == dominantColor);
+		pixel = !img.get(i, j);
 
 		if (prvColor == pixel) {
 			++runCnt;
@@ -313,49 +670,388 @@ void Compressor::encodeRunLengthZigZag(const cv::Mat& img, vector<int>& encodedD
 			i = img.rows - 1;
 			dir = 1 - dir;
 		}
-		else if (j >= img.cols) {
-			j = img.cols - 1;
-			dir = 1 - dir;
+		else if (j >= img.cols) {
+			j = img.cols - 1;
+			dir = 1 - dir;
+		}
+	}
+
+	encodedData.push_back(runCnt);
+}
+
+void Compressor::countRunsHorizontalVertical(const Bitmap& img, int& horRunsCount, int& verRunsCount) {
+	const uint64_t EVEN_COLS = 0x5555555555555555ULL;
+	const uint64_t ODD_COLS = 0xAAAAAAAAAAAAAAAAULL;
+
+	// The first run is of the dominant color, so it is empty if the first pixel is not
+	horRunsCount = verRunsCount = 1 + img.get(0, 0);
+
+	for (int i = 0; i < img.rows; ++i) {
+		const uint64_t* row = img.ptr(i);
+		const uint64_t* nextRow = (i + 1 < img.rows ? img.ptr(i + 1) : NULL);
+
+		for (int w = 0; w < img.rowWords; ++w) {
+			uint64_t rowTransitions = img.transitions(i, w);
+
+			// Runs breaking within the row
+			horRunsCount += Bitmap::popCount(rowTransitions);
+
+			// Runs breaking within the columns
+			if (nextRow)
+				verRunsCount += Bitmap::popCount(row[w] ^ nextRow[w]);
+
+			// Runs breaking when the vertical traversal moves from a column to the next one,
+			// it moves at the last row after even columns and at the first row after odd ones
+			if (i == 0)
+				verRunsCount += Bitmap::popCount(rowTransitions & ODD_COLS);
+			if (i == img.rows - 1)
+				verRunsCount += Bitmap::popCount(rowTransitions & EVEN_COLS);
+		}
+
+		// Runs breaking when the horizontal traversal moves from the row to the next one
+		if (nextRow) {
+			int j = (i & 1) ? 0 : img.cols - 1;
+			horRunsCount += (img.get(i, j) != img.get(i + 1, j));
+		}
+	}
+}
+
+int Compressor::countRunsSpiral(const Bitmap& img) {
+	int i = 0, j = img.cols - 1;
+	int up = 0, down = img.rows - 1, left = 0, right = img.cols - 1;
+	int cellsVisCount = 0, cellsCount = img.rows * img.cols;
+	int dir = 1;
+	int dR[4] = { 0, 1, 0, -1 };
+	int dC[4] = { 1, 0, -1, 0 };
+	int runsCount = 1;
+	bool pixel, prvPixel = false;
+
+	while (cellsVisCount++ < cellsCount) {
+		pixel = img.get(i, j);
+		runsCount += (pixel != prvPixel);
+		prvPixel = pixel;
+
+		int toR = i + dR[dir];
+		int toC = j + dC[dir];
+
+		if (toR > down) {
+			--right;
+			dir = (dir == 3) ? 0 : dir + 1;
+		}
+		else if (toR < up) {
+			++left;
+			dir = (dir == 3) ? 0 : dir + 1;
+		}
+		else if (toC > right) {
+			++up;
+			dir = (dir == 3) ? 0 : dir + 1;
+		}
+		else if (toC < left) {
+			--down;
+			dir = (dir == 3) ? 0 : dir + 1;
+		}
+
+		i += dR[dir];
+		j += dC[dir];
+	}
+
+	return runsCount;
+}
+
+int Compressor::countRunsZigZag(const Bitmap& img) {
+	int i = img.rows - 1, j = img.cols - 1;
+	int cellsVisCount = 0, cellsCount = img.rows * img.cols;
+	int dir = 0;
+	int dR[2] = { 1, -1 };
+	int dC[2] = { -1, 1 };
+	int runsCount = 1;
+	bool pixel, prvPixel = false;
+
+	while (cellsVisCount++ < cellsCount) {
+		pixel = img.get(i, j);
+		runsCount += (pixel != prvPixel);
+		prvPixel = pixel;
+
+		i += dR[dir];
+		j += dC[dir];
+
+		if (i < 0) {
+			i = 0;
+			j -= 2;
+			dir = 1 - dir;
+		}
+		else if (j < 0) {
+			j = 0;
+			i -= 2;
+			dir = 1 - dir;
+		}
+		else if (i >= img.rows) {
+			i = img.rows - 1;
+			dir = 1 - dir;
+		}
+		else if (j >= img.cols) {
+			j = img.cols - 1;
+			dir = 1 - dir;
+		}
+	}
+
+	return runsCount;
+}
+
+void Compressor::encodeMetaData() {
+	// Encode compression configuration
+	concatenatedData.push_back((dominantColor == 255 ? 1 : 0) | (streamVByte ? 2 : 0) | (shapeSymmetry ? 4 : 0) | (widePositions ? 8 : 0) | (spatialIndex ? 16 : 0) | (useDictionary ? 32 : 0));
+}
+
+void Compressor::encodeEntropy(vector<uchar>& outputBytes) {
+	outputBytes.push_back(entropyCoder);
+
+	if (entropyCoder == ENTROPY_ARITHMETIC) {
+		ArithmeticCoder coder;
+		coder.encode(this->concatenatedData, outputBytes);
+	}
+	else if (entropyCoder == ENTROPY_ANS) {
+		ANSCoder coder;
+		coder.encode(this->concatenatedData, outputBytes);
+	}
+	else {
+		Huffman huffman;
+		huffman.encode(this->concatenatedData, outputBytes, huffmanStreamsCount);
+	}
+}
+
+// ==============================================================================
+//
+// Compression helper functions
+//
+
+void Compressor::detectImageBlocks() {
+	labelImageRuns();
+
+	// Get the boundaries of each component, the components are visited in the
+	// row-major order of their first pixels as their roots are their first runs
+	vector<int> runComponent(runs.size());
+	vector<int> minRow, minCol, maxRow, maxCol;
+
+	for (int i = 0; i < runs.size(); ++i) {
+		int root = findRun(runParent, i);
+
+		if (root == i) {
+			runComponent[i] = minRow.size();
+			minRow.push_back(runs[i].row);
+			minCol.push_back(runs[i].startCol);
+			maxRow.push_back(runs[i].row);
+			maxCol.push_back(runs[i].endCol);
+			continue;
+		}
+
+		int c = runComponent[i] = runComponent[root];
+		minCol[c] = min(minCol[c], runs[i].startCol);
+		maxRow[c] = max(maxRow[c], runs[i].row);
+		maxCol[c] = max(maxCol[c], runs[i].endCol);
+	}
+
+	// Scan common shapes
+	for (int c = 0; c < minRow.size(); ++c) {
+		Bitmap shape = imageBits.crop(minRow[c], minCol[c], maxRow[c] - minRow[c] + 1, maxCol[c] - minCol[c] + 1);
+
+		// Store block info
+		long long startPixelIdx = (long long)imageBits.cols * minRow[c] + minCol[c];
+		int blockShapeIdx = storeUniqueShape(shape);
+		imageBlocks.push_back({ startPixelIdx, blockShapeIdx });
+	}
+
+	sortImageBlocks();
+}
+
+bool Compressor::detectImageBlocks(RowSource& source) {
+	vector<PixelRun> prvRuns, curRuns;
+	vector<int> prvLabels, curLabels;           // Component of each run of the previous and current rows
+	vector<ComponentBox> prvBoxes, boxes;       // Boxes of the previous row components, then of all the row components
+	vector<int> parent, newLabel;
+	vector<bool> growing;
+	Bitmap window;                              // Image rows starting from the first row of the incomplete components
+	int windowRow = 0;
+	cv::Mat stripe;
+	int sourceColor = source.getDominantColor();
+	long long blockPixels = 0;                  // Number of the read block colored pixels
+
+	imageRows = imageCols = 0;
+
+	for (int count; (count = source.readRows(STREAM_STRIPE_ROWS, stripe)) > 0; ) {
+		// Take the dominant color from the source, or detect it from the first stripe
+		if (imageRows == 0) {
+			imageCols = stripe.cols;
+
+			if (sourceColor != -1) {
+				dominantColor = sourceColor;
+			}
+			else {
+				long long whiteCnt = Bitmap(stripe, 0).countSet();
+				dominantColor = (whiteCnt * 2 > (long long)count * imageCols ? 255 : 0);
+			}
+
+			blockColor = 255 - dominantColor;
+		}
+
+		Bitmap stripeBits(stripe, dominantColor);
+		window.appendRows(stripeBits);
+
+		// The background of the rows read so far is of the block color if the detected dominant
+		// color is wrong, then it grows as a single component keeping all the rows in memory,
+		// so stop before reading more rows
+		blockPixels += stripeBits.countSet();
+		if (sourceColor == -1 && blockPixels * 2 > (long long)(imageRows + count) * imageCols) {
+			// throw exception("The dominant color detected from the first stripe is wrong");
+			cerr << "The dominant color detected from the first stripe is wrong, the row source should give it" << endl;
+			return false;
+		}
+
+		for (int r = 0; r < count; ++r, ++imageRows) {
+			// The previous row components take the first labels followed by the current row runs,
+			// the previous row boxes buffer is reused for the current row boxes
+			swap(boxes, prvBoxes);
+			int prvCount = boxes.size();
+			curRuns.clear();
+			curLabels.clear();
+
+			for (int j = stripeBits.findNext(r, 0, true); j < imageCols; j = stripeBits.findNext(r, j, true)) {
+				int startCol = j;
+				j = stripeBits.findNext(r, j, false);
+
+				curRuns.push_back({ imageRows, startCol, j - 1 });
+				curLabels.push_back(boxes.size());
+				boxes.push_back({ imageRows, startCol, imageRows, j - 1, (long long)imageRows * imageCols + startCol });
+			}
+
+			parent.resize(boxes.size());
+			for (int i = 0; i < parent.size(); ++i) {
+				parent[i] = i;
+			}
+
+			// Union each run with the previous row runs touching it, including diagonally
+			for (int c = 0, p = 0; c < curRuns.size(); ++c) {
+				while (p < prvRuns.size() && prvRuns[p].endCol < curRuns[c].startCol - 1) ++p;
+
+				for (int q = p; q < prvRuns.size() && prvRuns[q].startCol <= curRuns[c].endCol + 1; ++q) {
+					mergeComponents(parent, boxes, curLabels[c], prvLabels[q]);
+				}
+			}
+
+			// The previous row components not reaching the current row are complete
+			growing.assign(boxes.size(), false);
+			for (int c = 0; c < curRuns.size(); ++c) {
+				growing[findRun(parent, curLabels[c])] = true;
+			}
+			for (int k = 0; k < prvCount; ++k) {
+				int root = findRun(parent, k);
+
+				if (!growing[root]) {
+					growing[root] = true;
+					storeComponent(window, windowRow, boxes[root]);
+				}
+			}
+
+			// Relabel the current row components densely for the next row
+			prvBoxes.clear();
+			newLabel.assign(boxes.size(), -1);
+			for (int c = 0; c < curRuns.size(); ++c) {
+				int root = findRun(parent, curLabels[c]);
+
+				if (newLabel[root] == -1) {
+					newLabel[root] = prvBoxes.size();
+					prvBoxes.push_back(boxes[root]);
+				}
+
+				curLabels[c] = newLabel[root];
+			}
+
+			swap(prvRuns, curRuns);
+			swap(prvLabels, curLabels);
+		}
+
+		// Drop the rows above all the incomplete components
+		int firstRow = imageRows;
+		for (int k = 0; k < prvBoxes.size(); ++k) {
+			firstRow = min(firstRow, prvBoxes[k].minRow);
 		}
+
+		window.eraseRows(firstRow - windowRow);
+		windowRow = firstRow;
 	}
 
-	encodedData.push_back(runCnt);
+	// The components reaching the last row are complete
+	for (int k = 0; k < prvBoxes.size(); ++k) {
+		storeComponent(window, windowRow, prvBoxes[k]);
+	}
+
+	orderShapes();
+	sortImageBlocks();
+	return true;
 }
 
-void Compressor::encodeMetaData() {
-	// Encode compression configuration
-	concatenatedData.push_back(dominantColor == 255 ? 1 : 0);
+void Compressor::storeComponent(const Bitmap& window, int windowRow, const ComponentBox& box) {
+	Bitmap shape = window.crop(box.minRow - windowRow, box.minCol, box.maxRow - box.minRow + 1, box.maxCol - box.minCol + 1);
+
+	// Store block info
+	long long startPixelIdx = (long long)imageCols * box.minRow + box.minCol;
+	int blockShapeIdx = storeUniqueShape(shape);
+	imageBlocks.push_back({ startPixelIdx, blockShapeIdx });
+
+	// Keep the first pixel of the earliest component of each shape
+	if (blockShapeIdx == shapeFirstPixels.size())
+		shapeFirstPixels.push_back(box.firstPixel);
+	else
+		shapeFirstPixels[blockShapeIdx] = min(shapeFirstPixels[blockShapeIdx], box.firstPixel);
 }
 
-// ==============================================================================
-//
-// Compression helper functions
-//
+void Compressor::orderShapes() {
+	// Number the shapes in the order their earliest components are met in a raster scan,
+	// as done when all the image is labeled at once
+	vector<int> order(shapes.size());
+	for (int i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
 
-void Compressor::detectImageBlocks() {
-	// Clear visited matrix
-	visited = cv::Mat::zeros(imageMat.rows, imageMat.cols, CV_8U);
+	sort(order.begin(), order.end(), [&](int lhs, int rhs) {
+		return shapeFirstPixels[lhs] < shapeFirstPixels[rhs];
+	});
 
-	// Scan common shapes
-	for (int i = 0; i < imageMat.rows; ++i) {
-		for (int j = 0; j < imageMat.cols; ++j) {
-			// Continue if previously visited or pixel is of background color
-			if (visited.at<bool>(i, j) || imageMat.at<uchar>(i, j) == dominantColor)
-				continue;
+	vector<int> shapeIdx(shapes.size());
+	vector<Bitmap> orderedShapes(shapes.size());
+
+	for (int i = 0; i < order.size(); ++i) {
+		shapeIdx[order[i]] = i;
+		swap(orderedShapes[i], shapes[order[i]]);
+	}
 
-			// Get shape boundries
-			minRow = minCol = 1e9;
-			maxRow = maxCol = -1e9;
-			dfs(i, j);
-			cv::Mat shape(imageMat, Range(minRow, maxRow + 1), Range(minCol, maxCol + 1));
+	shapes.swap(orderedShapes);
 
-			// Store block info
-			int startPixelIdx = imageMat.cols * minRow + minCol;
-			int blockShapeIdx = storeUniqueShape(shape);
-			imageBlocks.push_back({ startPixelIdx, blockShapeIdx });
-		}
+	for (int i = 0; i < imageBlocks.size(); ++i) {
+		imageBlocks[i].second = shapeIdx[imageBlocks[i].second];
+	}
+}
+
+void Compressor::mergeComponents(vector<int>& parent, vector<ComponentBox>& boxes, int comp1, int comp2) {
+	comp1 = findRun(parent, comp1);
+	comp2 = findRun(parent, comp2);
+
+	if (comp1 == comp2) {
+		return;
 	}
+	if (comp2 < comp1) {
+		swap(comp1, comp2);
+	}
+
+	parent[comp2] = comp1;
+	boxes[comp1].minRow = min(boxes[comp1].minRow, boxes[comp2].minRow);
+	boxes[comp1].minCol = min(boxes[comp1].minCol, boxes[comp2].minCol);
+	boxes[comp1].maxRow = max(boxes[comp1].maxRow, boxes[comp2].maxRow);
+	boxes[comp1].maxCol = max(boxes[comp1].maxCol, boxes[comp2].maxCol);
+	boxes[comp1].firstPixel = min(boxes[comp1].firstPixel, boxes[comp2].firstPixel);
+}
 
+void Compressor::sortImageBlocks() {
 	// Sort image blocks in non-decreasing order of start pixels in order to apply relative positioning
 	sort(imageBlocks.begin(), imageBlocks.end());
 
@@ -366,63 +1062,180 @@ void Compressor::detectImageBlocks() {
 	}
 }
 
-int Compressor::storeUniqueShape(const cv::Mat& shape) {
-	for (int i = 0; i < shapes.size(); ++i) {
-		if (shape.size() != shapes[i].size())
-			continue;
+int Compressor::storeUniqueShape(const Bitmap& shape) {
+	// Only the shapes with the same size and hash can be identical
+	vector<int>& candidates = shapesIndex[shape.hash()];
 
-		if (countNonZero(shape ^ shapes[i]) == 0)
-			return i;
+	for (int i = 0; i < candidates.size(); ++i) {
+		if (shape == shapes[candidates[i]])
+			return candidates[i];
 	}
 
 	shapes.push_back(shape);
+	candidates.push_back((int)shapes.size() - 1);
 	return (int)shapes.size() - 1;
 }
 
-void Compressor::dfs(int row, int col) {
-	// Get boundries
-	minRow = min(minRow, row);
-	minCol = min(minCol, col);
-	maxRow = max(maxRow, row);
-	maxCol = max(maxCol, col);
+void Compressor::mapSharedShapes() {
+	vector<pair<int, int>> sharedShapes;    // Dictionary index and shape index of each shared shape
+	vector<int> order;
+
+	for (int i = 0; i < shapes.size(); ++i) {
+		int dictionaryIdx = dictionary->find(shapes[i], shapes[i].hash());
+
+		if (dictionaryIdx != -1)
+			sharedShapes.push_back(make_pair(dictionaryIdx, i));
+	}
+
+	sort(sharedShapes.begin(), sharedShapes.end());
+
+	// Put the shared shapes first followed by the other shapes in their current order
+	vector<bool> shared(shapes.size(), false);
+	for (int i = 0; i < sharedShapes.size(); ++i) {
+		order.push_back(sharedShapes[i].second);
+		sharedShapeIds.push_back(sharedShapes[i].first);
+		shared[sharedShapes[i].second] = true;
+	}
+	for (int i = 0; i < shapes.size(); ++i) {
+		if (!shared[i])
+			order.push_back(i);
+	}
+
+	// Renumber the shapes and their refering blocks
+	vector<Bitmap> orderedShapes(shapes.size());
+	vector<vector<int>> orderedShapeBlocks(shapes.size());
+	vector<int> newIdx(shapes.size());
+
+	for (int i = 0; i < order.size(); ++i) {
+		swap(orderedShapes[i], shapes[order[i]]);
+		swap(orderedShapeBlocks[i], shapeBlocks[order[i]]);
+		newIdx[order[i]] = i;
+	}
+	for (int i = 0; i < imageBlocks.size(); ++i) {
+		imageBlocks[i].second = newIdx[imageBlocks[i].second];
+	}
+
+	swap(shapes, orderedShapes);
+	swap(shapeBlocks, orderedShapeBlocks);
+	sharedShapesCount = sharedShapes.size();
+}
+
+void Compressor::labelImageRuns() {
+	runs.clear();
+	runParent.clear();
+
+	// Split the image into horizontal stripes and label them in parallel
+	int stripesCount = max(1, min(threadsCount, imageBits.rows / MIN_STRIPE_ROWS));
+	vector<vector<PixelRun>> stripeRuns(stripesCount);
+	vector<vector<int>> stripeParents(stripesCount);
+	vector<int> stripeStartRow(stripesCount + 1);
+
+	for (int s = 0; s <= stripesCount; ++s) {
+		stripeStartRow[s] = (int)((long long)imageBits.rows * s / stripesCount);
+	}
+
+	if (stripesCount == 1) {
+		labelStripe(0, imageBits.rows, runs, runParent);
+		return;
+	}
 
-	// Set current pixel as visisted
-	visited.at<bool>(row, col) = true;
+	runParallel(stripesCount, [&](int s) {
+		labelStripe(stripeStartRow[s], stripeStartRow[s + 1], stripeRuns[s], stripeParents[s]);
+	});
 
-	// Visit neighbours
-	for (int i = 0; i < 8; ++i) {
-		int toR = row + dirR[i];
-		int toC = col + dirC[i];
+	// Concatenate the stripes runs in row-major order, each stripe root stays
+	// the earliest run of its component within the stripe
+	for (int s = 0; s < stripesCount; ++s) {
+		int offset = runs.size();
 
-		if (valid(toR, toC) && !visited.at<bool>(toR, toC)) {
-			dfs(toR, toC);
+		runs.insert(runs.end(), stripeRuns[s].begin(), stripeRuns[s].end());
+		for (int i = 0; i < stripeParents[s].size(); ++i) {
+			runParent.push_back(stripeParents[s][i] + offset);
 		}
 	}
+
+	// Merge the components crossing the seams between consecutive stripes
+	int stripeBegin = 0;
+	for (int s = 0; s + 1 < stripesCount; ++s) {
+		int stripeEnd = stripeBegin + stripeRuns[s].size();
+		int seamRow = stripeStartRow[s + 1];
+
+		// Runs of the last row of the upper stripe and of the first row of the lower stripe
+		int prvBegin = stripeEnd;
+		while (prvBegin > stripeBegin && runs[prvBegin - 1].row == seamRow - 1) --prvBegin;
+
+		int curEnd = stripeEnd;
+		while (curEnd < runs.size() && runs[curEnd].row == seamRow) ++curEnd;
+
+		connectRows(runs, runParent, prvBegin, stripeEnd, stripeEnd, curEnd);
+		stripeBegin = stripeEnd;
+	}
 }
 
-bool Compressor::valid(int row, int col) {
-	return (
-		row >= 0 && row < imageMat.rows &&
-		col >= 0 && col < imageMat.cols && 
-		imageMat.at<uchar>(row, col) == blockColor
-	);
+void Compressor::labelStripe(int startRow, int endRow, vector<PixelRun>& stripeRuns, vector<int>& parent) {
+	int prvBegin = 0, prvEnd = 0;
+
+	for (int i = startRow; i < endRow; ++i) {
+		int curBegin = stripeRuns.size();
+
+		// Extract the runs of the current row skipping a word at a time
+		for (int j = imageBits.findNext(i, 0, true); j < imageBits.cols; j = imageBits.findNext(i, j, true)) {
+			int startCol = j;
+			j = imageBits.findNext(i, j, false);
+
+			stripeRuns.push_back({ i, startCol, j - 1 });
+			parent.push_back(stripeRuns.size() - 1);
+		}
+
+		connectRows(stripeRuns, parent, prvBegin, prvEnd, curBegin, stripeRuns.size());
+
+		prvBegin = curBegin;
+		prvEnd = stripeRuns.size();
+	}
 }
 
-void Compressor::detectDominantColor() {
-	int whiteCnt = 0;
+void Compressor::connectRows(const vector<PixelRun>& rowRuns, vector<int>& parent, int prvBegin, int prvEnd, int curBegin, int curEnd) {
+	// Union each run with the previous row runs touching it, including diagonally
+	for (int r = curBegin, p = prvBegin; r < curEnd; ++r) {
+		// Skip the previous runs ending before the current one can touch them
+		while (p < prvEnd && rowRuns[p].endCol < rowRuns[r].startCol - 1) ++p;
 
-	for (int i = 0; i < imageMat.rows; ++i) {
-		for (int j = 0; j < imageMat.cols; ++j) {
-			whiteCnt += ((int)imageMat.at<uchar>(i, j) > 0);
+		for (int q = p; q < prvEnd && rowRuns[q].startCol <= rowRuns[r].endCol + 1; ++q) {
+			unionRuns(parent, r, q);
 		}
 	}
+}
 
-	dominantColor = (whiteCnt * 2 > imageMat.rows * imageMat.cols ? 255 : 0);
-	blockColor = 255 - dominantColor;
+int Compressor::findRun(vector<int>& parent, int run) {
+	while (parent[run] != run) {
+		parent[run] = parent[parent[run]];
+		run = parent[run];
+	}
+
+	return run;
+}
+
+void Compressor::unionRuns(vector<int>& parent, int run1, int run2) {
+	run1 = findRun(parent, run1);
+	run2 = findRun(parent, run2);
+
+	if (run1 < run2)
+		parent[run2] = run1;
+	else if (run2 < run1)
+		parent[run1] = run2;
 }
 
-bool cmp(const pair<vector<int>, int>& lhs, const pair<vector<int>, int>& rhs) {
-	return lhs.first.size() < rhs.first.size();
+void Compressor::detectDominantColor() {
+	// The image bits are initially set for the white pixels
+	long long whiteCnt = imageBits.countSet();
+
+	dominantColor = (whiteCnt * 2 > (long long)imageBits.rows * imageBits.cols ? 255 : 0);
+	blockColor = 255 - dominantColor;
+
+	// Keep the set bits for the block color pixels
+	if (dominantColor == 255) {
+		imageBits.invert();
+	}
 }
 
 // ==============================================================================
@@ -432,24 +1245,17 @@ bool cmp(const pair<vector<int>, int>& lhs, const pair<vector<int>, int>& rhs) {
 
 void Compressor::extract(vector<uchar>& compressedBytes, cv::Mat& outputImage) {
 	// Clear previous records
-	dataIdx = 0;
-	this->compressedData.clear();
-	this->concatenatedData.clear();
-	this->shapes.clear();
-	this->shapeBlocks.clear();
-	this->imageBlocks.clear();
-	this->blockShapes.clear();
-	
-	// Decode huffman encoded data and pass it to compressor object
-	Huffman huffman;
-	huffman.decode(compressedBytes, this->concatenatedData);
+	clearRecords();
 
-	// Retrieve compression meta-data
-	decodeMetaData();
+	// Decode all the tiles of the files having a spatial index
+	if (!compressedBytes.empty() && compressedBytes[0] == TILED_FILE_MARK) {
+		decodeTiles(compressedBytes, cv::Rect(0, 0, INT_MAX, INT_MAX));
+		outputImage = this->imageMat;
+		return;
+	}
 
-	// De-concatenate compressed data bits
-	ByteConcatenator concat;
-	concat.deconcatenate(this->concatenatedData, this->compressedData);
+	// Decode compressed data
+	decodeInput(compressedBytes);
 
 	// Decode image
 	decodeAdvanced();
@@ -458,87 +1264,377 @@ void Compressor::extract(vector<uchar>& compressedBytes, cv::Mat& outputImage) {
 	outputImage = this->imageMat;
 }
 
+void Compressor::extractDictionary(vector<uchar>& compressedBytes, ShapeDictionary& outputDictionary) {
+	// Clear previous records
+	clearRecords();
+
+	// Decode compressed data
+	decodeInput(compressedBytes);
+
+	// Retrieve the dictionary identifier and shapes
+	uint32_t id = compressedData[dataIdx++];
+	decodeDistinctShapes();
+
+	outputDictionary = ShapeDictionary();
+	for (int i = 0; i < shapes.size(); ++i) {
+		outputDictionary.add(shapes[i]);
+	}
+	outputDictionary.updateId();
+
+	if (outputDictionary.getId() != id) {
+		// throw exception("The extracted dictionary is corrupted");
+		cerr << "The extracted dictionary is corrupted" << endl;
+	}
+}
+
+void Compressor::extract(vector<uchar>& compressedBytes, const cv::Rect& region, cv::Mat& outputImage) {
+	// Clear previous records
+	clearRecords();
+
+	// Decode the region tiles only if the spatial index is stored, otherwise decode the whole image
+	if (!compressedBytes.empty() && compressedBytes[0] == TILED_FILE_MARK) {
+		decodeTiles(compressedBytes, region);
+	}
+	else {
+		decodeInput(compressedBytes);
+		decodeAdvanced();
+
+		imageMat = imageMat(clipRegion(region, imageMat.rows, imageMat.cols)).clone();
+	}
+
+	// Pass image to function caller
+	outputImage = this->imageMat;
+}
+
+void Compressor::decodeInput(vector<uchar>& compressedBytes) {
+	// Decode entropy encoded data and pass it to compressor object
+	decodeEntropy(compressedBytes);
+
+	// Retrieve compression meta-data
+	decodeMetaData();
+
+	// De-concatenate compressed data bits
+	ByteConcatenator concat;
+	if (fileFlags.streamVByte)
+		concat.deconcatenateStreamVByte(this->concatenatedData, this->compressedData);
+	else
+		concat.deconcatenate(this->concatenatedData, this->compressedData);
+}
+
 void Compressor::decodeAdvanced() {
 	// Retrieve image rows & cols count
 	int rows = compressedData[dataIdx++];
 	int cols = compressedData[dataIdx++];
 
-	imageMat = cv::Mat(rows, cols, CV_8U, cv::Scalar(dominantColor));
+	imageBits = Bitmap(rows, cols);
+
+	if (fileFlags.useDictionary && !decodeSharedShapes(true)) {
+		imageMat = cv::Mat();
+		return;
+	}
 
 	decodeDistinctShapes();
 	decodeImageBlocks();
+
+	imageBits.toMat(imageMat, blockColor, dominantColor);
 }
 
 void Compressor::decodeDistinctShapes() {
-	// Retrieve distinct shapes count
+	// Retrieve distinct shapes count and encoding types
+	vector<int> shapesEncodingType;
+	int shapesCount = decodeShapesTypes(shapesEncodingType);
+
+	// Retrieve image distinct shapes and their refering blocks, following the shared shapes
+	for (int i = 0; i < shapesCount; ++i) {
+		decodeShape(sharedShapesCount + i, shapesEncodingType[i]);
+		decodeShapeBlocks(sharedShapesCount + i);
+	}
+}
+
+bool Compressor::decodeSharedShapes(bool withBlocks) {
+	uint32_t dictionaryId = compressedData[dataIdx++];
+
+	// Use the set dictionary if it is the one of the file, otherwise look it up in the loaded ones
+	const ShapeDictionary* sharedDictionary = dictionary;
+
+	if (sharedDictionary == NULL || sharedDictionary->getId() != dictionaryId) {
+		unordered_map<uint32_t, ShapeDictionary>::const_iterator it = loadedDictionaries.find(dictionaryId);
+		sharedDictionary = (it == loadedDictionaries.end() ? NULL : &it->second);
+	}
+
+	if (sharedDictionary == NULL) {
+		// throw exception("The dictionary of the given file is not loaded");
+		cerr << "The dictionary of the given file is not loaded" << endl;
+		return false;
+	}
+
+	sharedShapesCount = compressedData[dataIdx++];
+	shapes.resize(sharedShapesCount);
+	shapeBlocks.resize(sharedShapesCount);
+
+	// Retrieve the shared shapes from the dictionary and their refering blocks
+	for (int i = 0, idx = 0; i < sharedShapesCount; ++i) {
+		idx += compressedData[dataIdx++];
+		shapes[i] = sharedDictionary->shapes[idx];
+		if (withBlocks)
+			decodeShapeBlocks(i);
+	}
+
+	return true;
+}
+
+int Compressor::decodeShapesTypes(vector<int>& shapesEncodingType) {
+	// Retrieve distinct shapes count, the shapes are stored after the shared shapes
 	int shapesCount = compressedData[dataIdx++];
-	shapes.resize(shapesCount);
-	shapeBlocks.resize(shapesCount);
+	shapes.resize(sharedShapesCount + shapesCount);
+	shapeBlocks.resize(sharedShapesCount + shapesCount);
 
-	// Retrieve shapes encoding type
+	// Retrieve shapes encoding type and symmetry
+	int typeBits = (fileFlags.shapeSymmetry ? 4 : 2);
 	int typeBytesCount = (shapesCount + 1) / 2;
-	vector<int> shapesEncodingType;
 	for (int i = 0; i < typeBytesCount; ++i) {
 		int type = compressedData[dataIdx++];
-		shapesEncodingType.push_back(type & 3);
-		shapesEncodingType.push_back((type >> 2) & 3);
+		shapesEncodingType.push_back(type & ((1 << typeBits) - 1));
+		shapesEncodingType.push_back(type >> typeBits);
 	}
 
-	// Retrieve image distinct shapes
-	for (int i = 0; i < shapesCount; ++i) {
-		int type = shapesEncodingType[i];
+	return shapesCount;
+}
+
+void Compressor::decodeShape(int shapeIdx, int encodingType) {
+	// Retrieve shape rows & cols count
+	int rows = compressedData[dataIdx++];
+	int cols = compressedData[dataIdx++];
+
+	decodeShapePixels(shapeIdx, encodingType, rows, cols);
+}
+
+void Compressor::decodeShapePixels(int shapeIdx, int encodingType, int rows, int cols) {
+	int type = encodingType & 3;
+	int symmetry = encodingType >> 2;
+
+	// Only the upper and/or left part of the symmetric shapes is stored
+	Bitmap& shape = shapes[shapeIdx];
+	shape = Bitmap((symmetry & SYMMETRY_HOR) ? (rows + 1) / 2 : rows, (symmetry & SYMMETRY_VER) ? (cols + 1) / 2 : cols);
+
+	if (type == RUN_LENGTH_HOR)
+		decodeRunLengthHorizontal(shape);
+	else if (type == RUN_LENGTH_VER)
+		decodeRunLengthVertical(shape);
+	else if (type == RUN_LENGTH_SPIRAL)
+		decodeRunLengthSpiral(shape);
+	else if (type == RUN_LENGTH_ZIGZAG)
+		decodeRunLengthZigZag(shape);
+
+	if (symmetry != SYMMETRY_NONE)
+		shape = unfoldShape(shape, rows, cols, symmetry);
+}
+
+void Compressor::decodeShapeBlocks(int shapeIdx) {
+	// Retrieve shape's refering blocks
+	int blocksCount = compressedData[dataIdx++];
+	shapeBlocks[shapeIdx].resize(blocksCount);
+	for (int j = 0, prv = 0; j < blocksCount; ++j) {
+		int blockIdx = compressedData[dataIdx++] + prv;
+		prv = blockIdx;
+		//shapeBlocks[shapeIdx][j] = blockIdx;
+		if (blockIdx >= blockShapes.size())
+			blockShapes.resize(blockIdx + 1);
+		blockShapes[blockIdx] = shapeIdx;
+	}
+}
+
+void Compressor::decodeTiles(vector<uchar>& compressedBytes, const cv::Rect& region) {
+	if (compressedBytes.size() < 1 + 6 * 4) {
+		// throw exception("Could not extract the given file");
+		cerr << "Could not extract the given file" << endl;
+		return;
+	}
+
+	// Retrieve the image and tiles sizes
+	size_t idx = 1;
+	int rows = readInt(compressedBytes, idx);
+	int cols = readInt(compressedBytes, idx);
+	int tileRows = readInt(compressedBytes, idx);
+	int tilesCount = readInt(compressedBytes, idx);
+	int chunkShapes = readInt(compressedBytes, idx);
+	int chunksCount = readInt(compressedBytes, idx);
+
+	// Retrieve the units positions, the header unit is followed by the shapes chunks then the tiles,
+	// and the earliest tile having blocks reaching each tile
+	int unitsCount = 1 + chunksCount + tilesCount;
+
+	if (chunksCount < 0 || tilesCount < 0 || (compressedBytes.size() - idx) / 4 < (size_t)unitsCount + tilesCount) {
+		// throw exception("Could not extract the given file");
+		cerr << "Could not extract the given file" << endl;
+		return;
+	}
+
+	vector<size_t> unitOffsets(unitsCount + 1);
+	vector<int> reach(tilesCount);
+
+	unitOffsets[0] = idx + 4 * (unitsCount + tilesCount);
+	for (int i = 0; i < unitsCount; ++i) {
+		unitOffsets[i + 1] = unitOffsets[i] + readInt(compressedBytes, idx);
+	}
+	for (int t = 0; t < tilesCount; ++t) {
+		reach[t] = readInt(compressedBytes, idx);
+	}
+
+	if (unitOffsets[unitsCount] > compressedBytes.size()) {
+		// throw exception("Could not extract the given file");
+		cerr << "Could not extract the given file" << endl;
+		return;
+	}
+
+	// Retrieve the shared shapes and the size and encoding type of each shape
+	decodeUnit(compressedBytes, unitOffsets[0], unitOffsets[1]);
+
+	if (fileFlags.useDictionary && !decodeSharedShapes(false)) {
+		imageMat = cv::Mat();
+		return;
+	}
+
+	int shapesCount = compressedData[dataIdx++];
+	shapes.resize(sharedShapesCount + shapesCount);
+
+	vector<int> shapesRows(shapes.size()), shapesCols(shapes.size()), shapesEncodingType(shapes.size());
+	vector<bool> decoded(shapes.size(), false);
+
+	for (int i = 0; i < sharedShapesCount; ++i) {
+		shapesRows[i] = shapes[i].rows;
+		shapesCols[i] = shapes[i].cols;
+		decoded[i] = true;
+	}
+	for (int i = sharedShapesCount; i < shapes.size(); ++i) {
+		shapesRows[i] = compressedData[dataIdx++];
+		shapesCols[i] = compressedData[dataIdx++];
+		shapesEncodingType[i] = compressedData[dataIdx++];
+	}
+
+	// Clip the region to the image
+	cv::Rect clipped = clipRegion(region, rows, cols);
+	int startRow = clipped.y, startCol = clipped.x;
+	int endRow = clipped.y + clipped.height, endCol = clipped.x + clipped.width;
+
+	imageBits = Bitmap(endRow - startRow, endCol - startCol);
+
+	if (imageBits.rows == 0 || imageBits.cols == 0) {
+		imageBits.toMat(imageMat, blockColor, dominantColor);
+		return;
+	}
+
+	// Retrieve the blocks intersecting the region from the tiles starting at the earliest tile
+	// reaching the region's first row, and mark the chunks of their shapes
+	vector<bool> neededChunks(chunksCount, false);
+
+	for (int t = reach[startRow / tileRows]; t <= (endRow - 1) / tileRows; ++t) {
+		decodeUnit(compressedBytes, unitOffsets[1 + chunksCount + t], unitOffsets[2 + chunksCount + t]);
 
-		if (type == RUN_LENGTH_HOR)
-			decodeRunLengthHorizontal(shapes[i]);
-		else if (type == RUN_LENGTH_VER)
-			decodeRunLengthVertical(shapes[i]);
-		else if (type == RUN_LENGTH_SPIRAL)
-			decodeRunLengthSpiral(shapes[i]);
-		else if (type == RUN_LENGTH_ZIGZAG)
-			decodeRunLengthZigZag(shapes[i]);
-		
-		// Retrieve shape's refering blocks
 		int blocksCount = compressedData[dataIdx++];
-		shapeBlocks[i].resize(blocksCount);
-		for (int j = 0, prv = 0; j < blocksCount; ++j) {
-			int blockIdx = compressedData[dataIdx++] + prv;
-			prv = blockIdx;
-			//shapeBlocks[i][j] = blockIdx;
-			blockShapes[blockIdx] = i;
+		long long pixel = (long long)t * tileRows * cols;
+
+		for (int j = 0; j < blocksCount; ++j) {
+			int blockShapeIdx = compressedData[dataIdx++];
+
+			if (fileFlags.widePositions)
+				pixel += (long long)compressedData[dataIdx++] << 31;
+			pixel += compressedData[dataIdx++];
+
+			int blockRow = pixel / cols;
+			int blockCol = pixel % cols;
+
+			if (blockRow < endRow && blockRow + shapesRows[blockShapeIdx] > startRow && blockCol < endCol && blockCol + shapesCols[blockShapeIdx] > startCol) {
+				imageBlocks.push_back({ pixel, blockShapeIdx });
+				if (!decoded[blockShapeIdx])
+					neededChunks[(blockShapeIdx - sharedShapesCount) / chunkShapes] = true;
+			}
+		}
+	}
+
+	// Decode the shapes of the marked chunks only
+	for (int k = 0; k < chunksCount; ++k) {
+		if (!neededChunks[k])
+			continue;
+
+		decodeUnit(compressedBytes, unitOffsets[1 + k], unitOffsets[2 + k]);
+
+		int first = sharedShapesCount + k * chunkShapes;
+		int last = min((int)shapes.size(), first + chunkShapes);
+		for (int i = first; i < last; ++i) {
+			decodeShapePixels(i, shapesEncodingType[i], shapesRows[i], shapesCols[i]);
 		}
 	}
+
+	// Paste the blocks intersecting the region
+	for (int i = 0; i < imageBlocks.size(); ++i) {
+		int blockRow = imageBlocks[i].first / cols;
+		int blockCol = imageBlocks[i].first % cols;
+		pasteClipped(shapes[imageBlocks[i].second], blockRow - startRow, blockCol - startCol);
+	}
+
+	imageBits.toMat(imageMat, blockColor, dominantColor);
+}
+
+cv::Rect Compressor::clipRegion(const cv::Rect& region, int rows, int cols) {
+	// Widen the region ends as they can overflow for regions reaching far beyond the image
+	int startRow = min(rows, max(0, region.y)), startCol = min(cols, max(0, region.x));
+	int endRow = max(startRow, (int)min((long long)rows, (long long)region.y + region.height));
+	int endCol = max(startCol, (int)min((long long)cols, (long long)region.x + region.width));
+
+	return cv::Rect(startCol, startRow, endCol - startCol, endRow - startRow);
+}
+
+void Compressor::decodeUnit(vector<uchar>& compressedBytes, size_t begin, size_t end) {
+	vector<uchar> unitBytes(compressedBytes.begin() + begin, compressedBytes.begin() + end);
+
+	dataIdx = 0;
+	compressedData.clear();
+	concatenatedData.clear();
+	decodeInput(unitBytes);
+}
+
+void Compressor::pasteClipped(const Bitmap& shape, int row, int col) {
+	if (row >= 0 && col >= 0 && row + shape.rows <= imageBits.rows && col + shape.cols <= imageBits.cols) {
+		imageBits.paste(shape, row, col);
+		return;
+	}
+
+	// Paste the part of the shape inside the image only
+	int top = max(0, -row), left = max(0, -col);
+	int bottom = min(shape.rows, imageBits.rows - row), right = min(shape.cols, imageBits.cols - col);
+
+	if (top < bottom && left < right) {
+		imageBits.paste(shape.crop(top, left, bottom - top, right - left), row + top, col + left);
+	}
 }
 
 void Compressor::decodeImageBlocks() {
-	int idx = 0, prv = 0;
+	int idx = 0;
+	int startRow = 0;
+	long long startCol = 0;
 
 	// Retrieve image blocks info
 	while (dataIdx < compressedData.size()) {
-		int startPixelIdx = compressedData[dataIdx++] + prv;
 		int blockShapeIdx = blockShapes[idx++];
 
-		//imageBlocks.push_back({ startPixelIdx, blockShapeIdx });
-
-		int startRow = startPixelIdx / imageMat.cols;
-		int startCol = startPixelIdx % imageMat.cols;
-
-		for (int i = 0; i < shapes[blockShapeIdx].rows; ++i) {
-			for (int j = 0; j < shapes[blockShapeIdx].cols; ++j) {
-				imageMat.at<uchar>(startRow + i, startCol + j) = shapes[blockShapeIdx].at<uchar>(i, j);
-			}
+		// Advance the start pixel by the relative offset, only dividing when moving to later rows
+		if (fileFlags.widePositions)
+			startCol += (long long)compressedData[dataIdx++] << 31;
+		startCol += compressedData[dataIdx++];
+		if (startCol >= imageBits.cols) {
+			startRow += startCol / imageBits.cols;
+			startCol %= imageBits.cols;
 		}
 
-		prv = startPixelIdx;// +shapes[blockShapeIdx].cols / 1.65;
+		imageBits.paste(shapes[blockShapeIdx], startRow, startCol);
 	}
 }
 
-void Compressor::decodeRunLengthHorizontal(cv::Mat& img) {
-	// Retrieve image rows & cols count
-	int rows = compressedData[dataIdx++];
-	int cols = compressedData[dataIdx++];
-
-	// Retrieve image pixels
-	img = cv::Mat(rows, cols, CV_8U);
+void Compressor::decodeRunLengthHorizontal(Bitmap& img) {
+	// Retrieve image pixels, the image is already sized and cleared
+	int rows = img.rows;
+	int cols = img.cols;
 	int dir = 1;
 	int initVal = 0;
 	int i = 0, j = 0;
@@ -549,7 +1645,8 @@ void Compressor::decodeRunLengthHorizontal(cv::Mat& img) {
 		runCnt = compressedData[dataIdx++];
 
 		while (runCnt--) {
-			img.at<uchar>(i, j) = (color ? dominantColor : blockColor);
+			if (!color)
+				img.set(i, j);
 
 			j += dir;
 
@@ -566,13 +1663,10 @@ void Compressor::decodeRunLengthHorizontal(cv::Mat& img) {
 	}
 }
 
-void Compressor::decodeRunLengthVertical(cv::Mat& img) {
-	// Retrieve image rows & cols count
-	int rows = compressedData[dataIdx++];
-	int cols = compressedData[dataIdx++];
-
-	// Retrieve image pixels
-	img = cv::Mat(rows, cols, CV_8U);
+void Compressor::decodeRunLengthVertical(Bitmap& img) {
+	// Retrieve image pixels, the image is already sized and cleared
+	int rows = img.rows;
+	int cols = img.cols;
 	int dir = 1;
 	int initVal = 0;
 	int i = 0, j = 0;
@@ -583,7 +1677,8 @@ void Compressor::decodeRunLengthVertical(cv::Mat& img) {
 		runCnt = compressedData[dataIdx++];
 
 		while (runCnt--) {
-			img.at<uchar>(i, j) = (color ? dominantColor : blockColor);
+			if (!color)
+				img.set(i, j);
 
 			i += dir;
 
@@ -600,14 +1695,8 @@ void Compressor::decodeRunLengthVertical(cv::Mat& img) {
 	}
 }
 
-void Compressor::decodeRunLengthSpiral(cv::Mat& img) {
-	// Retrieve image rows & cols count
-	int rows = compressedData[dataIdx++];
-	int cols = compressedData[dataIdx++];
-	
-	// Retrieve image pixels
-	img = cv::Mat(rows, cols, CV_8U);
-	
+void Compressor::decodeRunLengthSpiral(Bitmap& img) {
+	// Retrieve image pixels, the image is already sized and cleared
 	int i = 0, j = img.cols - 1;
 	int up = 0, down = img.rows - 1, left = 0, right = img.cols - 1;
 	int cellsVisCount = 0, cellsCount = img.rows * img.cols;
@@ -624,7 +1713,8 @@ void Compressor::decodeRunLengthSpiral(cv::Mat& img) {
 			continue;
 		}
 
-		img.at<uchar>(i, j) = (color ? dominantColor : blockColor);
+		if (!color)
+			img.set(i, j);
 		++cellsVisCount;
 		--runCnt;
 
@@ -653,14 +1743,8 @@ void Compressor::decodeRunLengthSpiral(cv::Mat& img) {
 	}
 }
 
-void Compressor::decodeRunLengthZigZag(cv::Mat& img) {
-	// Retrieve image rows & cols count
-	int rows = compressedData[dataIdx++];
-	int cols = compressedData[dataIdx++];
-
-	// Retrieve image pixels
-	img = cv::Mat(rows, cols, CV_8U);
-
+void Compressor::decodeRunLengthZigZag(Bitmap& img) {
+	// Retrieve image pixels, the image is already sized and cleared
 	int i = img.rows - 1, j = img.cols - 1;
 	int cellsVisCount = 0, cellsCount = img.rows * img.cols;
 	int dir = 0;
@@ -676,7 +1760,8 @@ void Compressor::decodeRunLengthZigZag(cv::Mat& img) {
 			continue;
 		}
 
-		img.at<uchar>(i, j) = (color ? dominantColor : blockColor);
+		if (!color)
+			img.set(i, j);
 		++cellsVisCount;
 		--runCnt;
 
@@ -710,6 +1795,49 @@ void Compressor::decodeMetaData() {
 	concatenatedData.pop_back();
 
 	// Retrieve dominant and block colors
-	dominantColor = (config == 1 ? 255 : 0);
+	dominantColor = ((config & 1) ? 255 : 0);
 	blockColor = 255 - dominantColor;
+
+	// Retrieve concatenation layout
+	fileFlags.streamVByte = (config & 2);
+
+	// Retrieve whether the shapes symmetry is stored
+	fileFlags.shapeSymmetry = (config & 4);
+
+	// Retrieve whether the block positions are split into two integers
+	fileFlags.widePositions = (config & 8);
+
+	// Retrieve whether the spatial index is stored
+	fileFlags.spatialIndex = (config & 16);
+
+	// Retrieve whether the shapes shared with other images are referred to in the dictionary
+	fileFlags.useDictionary = (config & 32);
+}
+
+void Compressor::decodeEntropy(const vector<uchar>& compressedBytes) {
+	if (compressedBytes.empty()) {
+		// throw exception("Could not extract the given file");
+		cerr << "Could not extract the given file" << endl;
+		return;
+	}
+
+	int coder = compressedBytes[0];
+	vector<uchar> encodedData(compressedBytes.begin() + 1, compressedBytes.end());
+
+	if (coder == ENTROPY_ARITHMETIC) {
+		ArithmeticCoder arithmeticCoder;
+		arithmeticCoder.decode(encodedData, this->concatenatedData);
+	}
+	else if (coder == ENTROPY_ANS) {
+		ANSCoder ansCoder;
+		ansCoder.decode(encodedData, this->concatenatedData);
+	}
+	else if (coder == ENTROPY_HUFFMAN) {
+		Huffman huffman;
+		huffman.decode(encodedData, this->concatenatedData);
+	}
+	else {
+		// throw exception("Unknown entropy coder");
+		cerr << "Unknown entropy coder" << endl;
+	}
 }
\ No newline at end of file
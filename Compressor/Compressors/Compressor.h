@@ -6,6 +6,12 @@
 #include <algorithm>
 #include <queue>
 #include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+#include <thread>
+#include <atomic>
+#include <functional>
 
 // OpenCV libraries
 #include <opencv2/core/core.hpp>
@@ -13,36 +19,128 @@
 #include <opencv2/highgui/highgui.hpp>
 
 // Custom libraries
+#include "../Utilities/ThreadPool.h"
+#include "Bitmap.h"
+#include "RowSource.h"
+#include "ShapeDictionary.h"
+#include "ByteIO.h"
 #include "ByteConcatenator.h"
 #include "Huffman.h"
+#include "ArithmeticCoder.h"
+#include "ANSCoder.h"
 
 using namespace cv;
 using namespace std;
 
-bool cmp(const pair<vector<int>, int>& lhs, const pair<vector<int>, int>& rhs);
+/**
+ * Entropy coders that can be used in the last compression stage,
+ * the used coder is stored in the first byte of the compressed file
+ */
+enum EntropyCoder {
+	ENTROPY_HUFFMAN = 0,
+	ENTROPY_ARITHMETIC = 1,
+	ENTROPY_ANS = 2
+};
+
+/**
+ * Horizontal run of block colored pixels needed to label the image connected components
+ */
+struct PixelRun {
+	int row;
+	int startCol;
+	int endCol;
+};
+
+/**
+ * Bounding box of an image connected component
+ */
+struct ComponentBox {
+	int minRow;
+	int minCol;
+	int maxRow;
+	int maxCol;
+	long long firstPixel;   // Start pixel of the component's first run
+};
+
+/**
+ * Format flags read from the configuration byte of the file being extracted,
+ * kept apart from the compression configuration chosen by the caller
+ */
+struct FormatFlags {
+	bool streamVByte = false;
+	bool shapeSymmetry = false;
+	bool widePositions = false;
+	bool spatialIndex = false;
+	bool useDictionary = false;
+};
+
+/**
+ * Shapes and blocks detected in an image, kept to encode the image later without detecting them again
+ */
+struct ImageDetection {
+	int rows = 0;
+	int cols = 0;
+	uchar dominantColor = 255;
+	vector<Bitmap> shapes;                  // Distinct shapes bitmaps
+	vector<vector<int>> shapeBlocks;        // Block indecies of each distinct shape
+	vector<pair<long long, int>> imageBlocks;   // Start pixel and reference shape index of each block
+};
 
 class Compressor
 {
 private:
 	// Image variables
 	cv::Mat imageMat;
+	Bitmap imageBits;                       // Packed image pixels, the set pixels are of the block color
 	uchar dominantColor = 255;
 	uchar blockColor = 0;
-	vector<cv::Mat> shapes;                 // Vector of distinct shapes matrices
+	vector<Bitmap> shapes;                  // Vector of distinct shapes bitmaps
 	vector<vector<int>> shapeBlocks;        // Vector holding the block indecies for each distinct shape
-	vector<pair<int, int>> imageBlocks;     // Vector holding all image blocks starting pixel and the reference shape index
-	unordered_map<int, int> blockShapes;    // Maps block to its reference shape
+	vector<pair<long long, int>> imageBlocks;   // Vector holding all image blocks starting pixel and the reference shape index
+	vector<int> blockShapes;                // Maps block index to its reference shape
+	unordered_map<uint64_t, vector<int>> shapesIndex;   // Maps shape size and content hash to the shapes having them
+
+	// Compression configuration
+	EntropyCoder entropyCoder = ENTROPY_HUFFMAN;
+	int huffmanStreamsCount = 1;
+	bool streamVByte = false;               // Concatenate the data bytes in Stream VByte layout
+	int threadsCount = 1;                   // Number of threads used to compress a single image
+	ThreadPool* threadPool = NULL;          // Pool running the parallel parts, own threads are started if not set
+	bool shapeSymmetry = false;             // Store only the upper and/or left part of the symmetric shapes
+	bool widePositions = false;             // Store the block positions in two integers, needed above 2^31 pixels
+	bool spatialIndex = false;              // Store the image in separately decodable tiles to decode image regions
+
+	// Parallelization constants
+	const int MIN_STRIPE_ROWS = 64;         // Minimum number of rows labeled by a single thread
+	const int MIN_WORKER_SHAPES = 16;       // Minimum number of shapes per thread to encode the shapes in parallel
+
+	// Spatial index variables
+	const uchar TILED_FILE_MARK = 0x80;     // First byte of the files having a spatial index, unused by the entropy coders
+	const int SPATIAL_INDEX_TILE_ROWS = 256;    // Number of rows of each tile holding the blocks starting in them
+	const int SPATIAL_INDEX_CHUNK_SHAPES = 32;  // Number of shapes encoded together in each shapes chunk
+
+	// Stripes compression variables
+	const int STREAM_STRIPE_ROWS = 256;     // Number of rows read from the row source at once
+	int imageRows = 0;
+	int imageCols = 0;
+	vector<long long> shapeFirstPixels;     // First pixel of the earliest component of each shape
+
+	// Shared shape dictionary variables
+	const ShapeDictionary* dictionary = NULL;   // Dictionary of the shapes shared with other images
+	bool useDictionary = false;             // Refer to the dictionary shapes instead of encoding them
+	int sharedShapesCount = 0;              // Number of leading shapes found in the dictionary
+	vector<int> sharedShapeIds;             // Dictionary index of each shared shape
+	unordered_map<uint32_t, ShapeDictionary> loadedDictionaries;   // Maps identifier to each loaded dictionary
 
 	// Compressed data variables
+	FormatFlags fileFlags;                  // Format flags of the file being extracted
 	int dataIdx = 0;
 	vector<int> compressedData;
 	vector<uchar> concatenatedData;
 
-	// DFS variables
-	cv::Mat visited;
-	int dirR[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
-	int dirC[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
-	int minRow, minCol, maxRow, maxCol;
+	// Connected components labeling variables
+	vector<PixelRun> runs;                  // Image runs in row-major order
+	vector<int> runParent;                  // Union-find parent of each run, the root is the component's first run
 
 	// Run-Length encoding types
 	const int RUN_LENGTH_HOR = 0;
@@ -50,6 +148,11 @@ private:
 	const int RUN_LENGTH_SPIRAL = 2;
 	const int RUN_LENGTH_ZIGZAG = 3;
 
+	// Shape symmetry flags
+	const int SYMMETRY_NONE = 0;
+	const int SYMMETRY_HOR = 1;             // The lower half mirrors the upper half
+	const int SYMMETRY_VER = 2;             // The right half mirrors the left half
+
 	// ==============================================================================
 	//
 	// Compression functions
@@ -60,52 +163,231 @@ public:
 	 */
 	void compress(const cv::Mat& imageMat, vector<uchar>& outputBytes);
 
+	/**
+	 * Compress the black & white image read from the given source in horizontal stripes,
+	 * only the rows of the components that can still grow are kept in memory;
+	 * the dominant color is given by the source or detected from the first stripe,
+	 * nothing is output if the rows read later show that the detected color is wrong
+	 */
+	void compress(RowSource& source, vector<uchar>& outputBytes);
+
+	/**
+	 * Compress the image of the given detection results, produced by the detect function
+	 */
+	void compress(const ImageDetection& detection, vector<uchar>& outputBytes);
+
+	/**
+	 * Set the number of interleaved Huffman streams used to encode the compressed data,
+	 * more streams allow faster decoding at the cost of a few header bytes
+	 */
+	void setHuffmanStreamsCount(int count);
+
+	/**
+	 * Set the entropy coder used in the last compression stage
+	 */
+	void setEntropyCoder(EntropyCoder coder);
+
+	/**
+	 * Enable or disable the Stream VByte layout for the concatenated data bytes,
+	 * which is faster to de-concatenate than the run length encoded bytes counts
+	 */
+	void setStreamVByte(bool enabled);
+
+	/**
+	 * Set the number of threads used to compress a single image
+	 */
+	void setThreadsCount(int count);
+
+	/**
+	 * Run the parallel parts of the compression on the given pool instead of starting threads,
+	 * the compressor can then run inside a task of the same pool without oversubscribing
+	 * the machine; pass NULL to start own threads
+	 */
+	void setThreadPool(ThreadPool* pool);
+
+	/**
+	 * Enable or disable storing only the upper and/or left part of the shapes
+	 * that are symmetric around their horizontal and/or vertical axes
+	 */
+	void setShapeSymmetry(bool enabled);
+
+	/**
+	 * Enable or disable storing a spatial index of the image blocks,
+	 * which allows decoding a region of the image without decoding all the shapes
+	 */
+	void setSpatialIndex(bool enabled);
+
+	/**
+	 * Set the dictionary of the shapes shared by several images, the image shapes found
+	 * in the dictionary are referred to by their dictionary indecies, the same dictionary
+	 * must be set to extract the image; pass NULL to encode all the shapes in the image
+	 */
+	void setDictionary(const ShapeDictionary* dictionary);
+
+	/**
+	 * Set the loaded dictionary of the given identifier as the shared shapes dictionary,
+	 * return false if no such dictionary is loaded
+	 */
+	bool selectDictionary(uint32_t id);
+
+	/**
+	 * Extract the given compressed dictionary and keep it loaded, the loaded dictionaries
+	 * are found by the identifiers stored in the compressed files when extracting them;
+	 * return the dictionary identifier
+	 */
+	uint32_t loadDictionary(vector<uchar>& dictionaryBytes);
+
+	/**
+	 * Build a dictionary of at most the given number of the shapes most frequently
+	 * repeated in the given sample images, the shapes used only once are not stored
+	 */
+	void trainDictionary(const vector<cv::Mat>& samples, int maxShapes, ShapeDictionary& outputDictionary);
+
+	/**
+	 * Compress the shapes of the given dictionary using the same stages as the images
+	 */
+	void compressDictionary(const ShapeDictionary& dictionary, vector<uchar>& outputBytes);
+
+	/**
+	 * Detect the distinct shapes of the given black & white image and
+	 * the number of blocks refering to each of them
+	 */
+	void detectShapes(const cv::Mat& imageMat, vector<Bitmap>& shapes, vector<int>& blocksCount);
+
+	/**
+	 * Detect the distinct shapes and the blocks of the given black & white image,
+	 * so the image can be inspected then compressed without detecting them again
+	 */
+	void detect(const cv::Mat& imageMat, ImageDetection& detection);
+
 private:
+	/**
+	 * Clear the records of the previously compressed or extracted image
+	 */
+	void clearRecords();
+
+	/**
+	 * Concatenate and entropy encode the compressed data into the given output bytes
+	 */
+	void encodeOutput(vector<uchar>& outputBytes);
+
+	/**
+	 * Encode the detected image shapes and blocks into the given output bytes,
+	 * in tiles when the spatial index is enabled
+	 */
+	void encodeImage(vector<uchar>& outputBytes);
+
 	/**
 	 * Encode the image by detecting the repeated shapes and encode them once
 	 */
 	void encodeAdvanced();
 
+	/**
+	 * Encode the image into separately entropy coded units: a header unit holding the size
+	 * of each shape, a unit per chunk of shapes pixels and a unit per tile of rows holding
+	 * the blocks starting in it; the units sizes and the earliest tile reaching each tile
+	 * are stored uncoded before the units so a region is decoded from its units only
+	 */
+	void encodeTiles(vector<uchar>& outputBytes);
+
+	/**
+	 * Concatenate and entropy encode the compressed data as a separate unit
+	 */
+	void encodeUnit(vector<uchar>& outputBytes);
+
 	/**
 	 * Encode image distinct shapes after detecting them by calling detectImageBlocks function
 	 */
 	void encodeDistinctShapes();
 
 	/**
-	 *
+	 * Encode the pixels of the image distinct shapes, in parallel when there are enough shapes,
+	 * storing the encoded shape and its encoding type at the shape index
+	 */
+	void encodeShapesPixels(vector<vector<int>>& encodedShapes, vector<int>& shapesEncodingType);
+
+	/**
+	 * Run the given task for each index in [0, count) in parallel, on the thread pool if set
 	 */
-	void applySymmetry(cv::Mat& img);
+	void runParallel(int count, function<void(int)> task);
+
+	/**
+	 * Keep claiming the next shape to encode until all the shapes are claimed,
+	 * storing the encoded shape and its encoding type at the shape index
+	 */
+	void encodeShapes(atomic<int>& nextShape, vector<vector<int>>& encodedShapes, vector<int>& shapesEncodingType);
+
+	/**
+	 * Return the symmetry flags of the given shape
+	 */
+	int detectSymmetry(const Bitmap& shape);
+
+	/**
+	 * Return the part of the given shape that is enough to restore it using its symmetry
+	 */
+	Bitmap foldShape(const Bitmap& shape, int symmetry);
 
 	/**
 	 * Encode image blocks upper left pixel indecies
 	 */
 	void encodeImageBlocks();
 
+	/**
+	 * Encode the dictionary identifier and the dictionary index of each shared shape,
+	 * followed by its refering blocks if requested, placed before the image distinct shapes
+	 */
+	void encodeSharedShapes(bool withBlocks);
+
 	/**
 	 * Encode the given image using run length encoding algorithm in horizontal mannar
 	 */
-	void encodeRunLengthHorizontal(const cv::Mat& img, vector<int>& encodedData);
+	void encodeRunLengthHorizontal(const Bitmap& img, vector<int>& encodedData);
 
 	/**
 	 * Encode the given image using run length encoding algorithm in vertical mannar
 	 */
-	void encodeRunLengthVertical(const cv::Mat& img, vector<int>& encodedData);
+	void encodeRunLengthVertical(const Bitmap& img, vector<int>& encodedData);
+
+	/**
+	 * Encode the runs of the given image pixels traversing its rows in serpentine mannar
+	 */
+	void encodeRunLengthSerpentine(const Bitmap& img, vector<int>& encodedData);
 
 	/**
 	 * Encode the given image using run length encoding algorithm in spiral mannar
 	 */
-	void encodeRunLengthSpiral(const cv::Mat& img, vector<int>& encodedData);
+	void encodeRunLengthSpiral(const Bitmap& img, vector<int>& encodedData);
 
 	/**
 	 * Encode the given image using run length encoding algorithm in zig-zag mannar
 	 */
-	void encodeRunLengthZigZag(const cv::Mat& img, vector<int>& encodedData);
+	void encodeRunLengthZigZag(const Bitmap& img, vector<int>& encodedData);
+
+	/**
+	 * Count the runs of the given image in both horizontal and vertical mannars in a single pass
+	 */
+	void countRunsHorizontalVertical(const Bitmap& img, int& horRunsCount, int& verRunsCount);
+
+	/**
+	 * Count the runs of the given image in spiral mannar
+	 */
+	int countRunsSpiral(const Bitmap& img);
+
+	/**
+	 * Count the runs of the given image in zig-zag mannar
+	 */
+	int countRunsZigZag(const Bitmap& img);
 
 	/**
 	 * Encode meta-data needed in decompression process
 	 */
 	void encodeMetaData();
 
+	/**
+	 * Encode the concatenated data using the selected entropy coder
+	 */
+	void encodeEntropy(vector<uchar>& outputBytes);
+
 	// ==============================================================================
 	//
 	// Compression helper functions
@@ -116,22 +398,73 @@ private:
 	 */
 	void detectImageBlocks();
 
+	/**
+	 * Detect the image blocks reading the image rows from the given source, each component
+	 * is stored as soon as a row does not extend it, then its rows can be dropped;
+	 * return false if the dominant color detected from the first stripe turns out wrong
+	 */
+	bool detectImageBlocks(RowSource& source);
+
+	/**
+	 * Store the block of the given component, given the image rows starting from the given row
+	 */
+	void storeComponent(const Bitmap& window, int windowRow, const ComponentBox& box);
+
+	/**
+	 * Number the shapes stored while reading the image rows in the same order
+	 * they would have when labeling the whole image at once
+	 */
+	void orderShapes();
+
+	/**
+	 * Merge the given two components and their bounding boxes
+	 */
+	void mergeComponents(vector<int>& parent, vector<ComponentBox>& boxes, int comp1, int comp2);
+
+	/**
+	 * Sort the image blocks by their start pixels and map each shape to its blocks
+	 */
+	void sortImageBlocks();
+
 	/**
 	 * Store the given shape and return a unique number representing it
 	 * if the shape already stored then it will not be inserted
 	 */
-	int storeUniqueShape(const cv::Mat& shape);
+	int storeUniqueShape(const Bitmap& shape);
+
+	/**
+	 * Move the shapes found in the dictionary before the other shapes
+	 * in the order of their dictionary indecies
+	 */
+	void mapSharedShapes();
+
+	/**
+	 * Extract the horizontal runs of the image and union the 8-connected runs
+	 * of consecutive rows, so each connected component becomes a tree of runs;
+	 * the image is split into stripes labeled in parallel then merged at the seams
+	 */
+	void labelImageRuns();
+
+	/**
+	 * Extract and union the runs of the given rows range into the given stripe runs
+	 */
+	void labelStripe(int startRow, int endRow, vector<PixelRun>& stripeRuns, vector<int>& parent);
+
+	/**
+	 * Union the runs of a row with the touching runs of the previous row,
+	 * given the index ranges of both rows runs
+	 */
+	void connectRows(const vector<PixelRun>& rowRuns, vector<int>& parent, int prvBegin, int prvEnd, int curBegin, int curEnd);
 
 	/**
-	 * Search the image using depth first search (DFS) algorithm to
-	 * detect the boundaries of the sphape around the given point
+	 * Return the root run of the component containing the given run
 	 */
-	void dfs(int row, int col);
+	int findRun(vector<int>& parent, int run);
 
 	/**
-	 * Check whether the given point is valid in the DFS movement
+	 * Merge the components of the given two runs keeping the earlier root
 	 */
-	bool valid(int row, int col);
+	void unionRuns(vector<int>& parent, int run1, int run2);
 	
 	/**
 	 * Detect the dominat color of the image
@@ -148,7 +481,23 @@ public:
 	*/
 	void extract(vector<uchar>& compressedBytes, cv::Mat& outputImage);
 
+	/**
+	 * Extract the given region of the given compressed file, only the blocks intersecting
+	 * the region and their shapes are decoded when the file has a spatial index
+	 */
+	void extract(vector<uchar>& compressedBytes, const cv::Rect& region, cv::Mat& outputImage);
+
+	/**
+	 * Extract the given compressed dictionary
+	 */
+	void extractDictionary(vector<uchar>& compressedBytes, ShapeDictionary& outputDictionary);
+
 private:
+	/**
+	 * Entropy decode, retrieve the meta-data and de-concatenate the given compressed bytes
+	 */
+	void decodeInput(vector<uchar>& compressedBytes);
+
 	/**
 	 * Decode the data by retrieving the distinct shapes then mapping all image blocks
 	 * to one of the shapes
@@ -160,33 +509,91 @@ private:
 	 */
 	void decodeDistinctShapes();
 
+	/**
+	 * Retrieve the shared shapes from the dictionary and their refering blocks indecies if stored,
+	 * return false if the image was compressed using another dictionary
+	 */
+	bool decodeSharedShapes(bool withBlocks);
+
+	/**
+	 * Decode the distinct shapes count and the encoding type of each shape,
+	 * and return the shapes count
+	 */
+	int decodeShapesTypes(vector<int>& shapesEncodingType);
+
+	/**
+	 * Decode the pixels of the given shape having the given encoding type
+	 */
+	void decodeShape(int shapeIdx, int encodingType);
+
+	/**
+	 * Decode the pixels of the given shape having the given encoding type and size
+	 */
+	void decodeShapePixels(int shapeIdx, int encodingType, int rows, int cols);
+
+	/**
+	 * Decode the indecies of the blocks refering to the given shape
+	 */
+	void decodeShapeBlocks(int shapeIdx);
+
+	/**
+	 * Decode the blocks intersecting the given region of a file having a spatial index,
+	 * only the units of the tiles reaching the region and of the chunks of their shapes are decoded
+	 */
+	void decodeTiles(vector<uchar>& compressedBytes, const cv::Rect& region);
+
+	/**
+	 * Return the part of the given region inside an image of the given size
+	 */
+	cv::Rect clipRegion(const cv::Rect& region, int rows, int cols);
+
+	/**
+	 * Entropy decode and de-concatenate the unit between the given positions of the given bytes
+	 */
+	void decodeUnit(vector<uchar>& compressedBytes, size_t begin, size_t end);
+
+	/**
+	 * Paste the part of the given shape inside the image at the given position
+	 */
+	void pasteClipped(const Bitmap& shape, int row, int col);
+
 	/**
 	 * Decode image blocks starting pixel indecies
 	 */
 	void decodeImageBlocks();
 
+	/**
+	 * Restore a shape of the given size from its stored part using its symmetry
+	 */
+	Bitmap unfoldShape(const Bitmap& part, int rows, int cols, int symmetry);
+
 	/**
 	 * Decode the given encoded image using run length decoding algorithm in horizontal mannar
 	 */
-	void decodeRunLengthHorizontal(cv::Mat& img);
+	void decodeRunLengthHorizontal(Bitmap& img);
 
 	/**
 	 * Decode the given encoded image using run length decoding algorithm in vertical mannar
 	 */
-	void decodeRunLengthVertical(cv::Mat& img);
+	void decodeRunLengthVertical(Bitmap& img);
 
 	/**
 	 * Decode the given encoded image using run length decoding algorithm in spiral mannar
 	 */
-	void decodeRunLengthSpiral(cv::Mat& img);
+	void decodeRunLengthSpiral(Bitmap& img);
 
 	/**
 	 * Decode the given encoded image using run length decoding algorithm in zig-zag mannar
 	 */
-	void decodeRunLengthZigZag(cv::Mat& img);
+	void decodeRunLengthZigZag(Bitmap& img);
 
 	/**
 	 * Decode image compressed meta-data needed in decompression process
 	 */
 	void decodeMetaData();
+
+	/**
+	 * Decode the given bytes using the entropy coder stored in their first byte
+	 */
+	void decodeEntropy(const vector<uchar>& compressedBytes);
 };
\ No newline at end of file
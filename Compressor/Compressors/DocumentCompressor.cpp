@@ -0,0 +1,174 @@
+#include "DocumentCompressor.h"
+
+//
+// Compression functions
+//
+
+void DocumentCompressor::compress(const vector<cv::Mat>& pages, vector<uchar>& outputBytes) {
+	vector<ImageDetection> detections;
+	buildDictionary(pages, detections);
+
+	// Store the compressed dictionary preceded by its size
+	vector<uchar> dictionaryBytes;
+	compressor.compressDictionary(dictionary, dictionaryBytes);
+
+	writeInt(outputBytes, dictionaryBytes.size());
+	outputBytes.insert(outputBytes.end(), dictionaryBytes.begin(), dictionaryBytes.end());
+
+	// Compress the pages referring to the dictionary shapes, reusing their detected shapes and blocks
+	vector<vector<uchar>> pagesBytes(pages.size());
+
+	compressor.setDictionary(&dictionary);
+	for (int i = 0; i < pages.size(); ++i) {
+		compressor.compress(detections[i], pagesBytes[i]);
+	}
+	compressor.setDictionary(NULL);
+
+	// Store the pages count and the size of each page followed by the pages
+	writeInt(outputBytes, pages.size());
+	for (int i = 0; i < pages.size(); ++i) {
+		writeInt(outputBytes, pagesBytes[i].size());
+	}
+	for (int i = 0; i < pages.size(); ++i) {
+		outputBytes.insert(outputBytes.end(), pagesBytes[i].begin(), pagesBytes[i].end());
+	}
+}
+
+Compressor& DocumentCompressor::getCompressor() {
+	return compressor;
+}
+
+void DocumentCompressor::buildDictionary(const vector<cv::Mat>& pages, vector<ImageDetection>& detections) {
+	ShapeDictionary candidates;
+	vector<int> pagesCount;                 // Number of pages having each candidate shape
+
+	// The detected shapes of a page are distinct, so each page counts once for each of its shapes
+	detections.resize(pages.size());
+	for (int i = 0; i < pages.size(); ++i) {
+		compressor.detect(pages[i], detections[i]);
+
+		const vector<Bitmap>& pageShapes = detections[i].shapes;
+		for (int j = 0; j < pageShapes.size(); ++j) {
+			int idx = candidates.add(pageShapes[j]);
+
+			if (idx == pagesCount.size())
+				pagesCount.push_back(0);
+			pagesCount[idx]++;
+		}
+	}
+
+	dictionary = ShapeDictionary();
+	for (int i = 0; i < candidates.size(); ++i) {
+		if (pagesCount[i] >= MIN_SHARED_PAGES)
+			dictionary.add(candidates.shapes[i]);
+	}
+	dictionary.updateId();
+}
+
+// ==============================================================================
+//
+// Extraction functions
+//
+
+void DocumentCompressor::extract(const vector<uchar>& compressedBytes, vector<cv::Mat>& outputPages) {
+	vector<size_t> pageOffsets;
+	outputPages.clear();
+
+	if (!readPagesTable(compressedBytes, pageOffsets))
+		return;
+
+	extractDictionary(compressedBytes);
+
+	outputPages.resize(pageOffsets.size() - 1);
+	for (int i = 0; i < outputPages.size(); ++i) {
+		extractPage(compressedBytes, pageOffsets, i, outputPages[i]);
+	}
+}
+
+void DocumentCompressor::extractPage(const vector<uchar>& compressedBytes, int pageIdx, cv::Mat& outputPage) {
+	vector<size_t> pageOffsets;
+
+	if (!readPagesTable(compressedBytes, pageOffsets))
+		return;
+
+	if (pageIdx < 0 || pageIdx >= (int)pageOffsets.size() - 1) {
+		// throw exception("Page index out of range");
+		cerr << "Page index out of range" << endl;
+		return;
+	}
+
+	extractDictionary(compressedBytes);
+	extractPage(compressedBytes, pageOffsets, pageIdx, outputPage);
+}
+
+int DocumentCompressor::getPagesCount(const vector<uchar>& compressedBytes) {
+	vector<size_t> pageOffsets;
+
+	if (!readPagesTable(compressedBytes, pageOffsets))
+		return 0;
+
+	return pageOffsets.size() - 1;
+}
+
+bool DocumentCompressor::readPagesTable(const vector<uchar>& compressedBytes, vector<size_t>& pageOffsets) {
+	size_t size = compressedBytes.size();
+	size_t idx = 0;
+	pageOffsets.clear();
+
+	// Skip the dictionary preceded by its size, then read the pages count
+	if (size < 4) {
+		// throw exception("The given container is corrupted");
+		cerr << "The given container is corrupted" << endl;
+		return false;
+	}
+
+	size_t dictionarySize = readInt(compressedBytes, idx);
+
+	if (size - idx < dictionarySize + 4) {
+		// throw exception("The given container is corrupted");
+		cerr << "The given container is corrupted" << endl;
+		return false;
+	}
+
+	idx += dictionarySize;
+	size_t pagesCount = readInt(compressedBytes, idx);
+
+	if ((size - idx) / 4 < pagesCount) {
+		// throw exception("The given container is corrupted");
+		cerr << "The given container is corrupted" << endl;
+		return false;
+	}
+
+	// The pages follow the pages table in order
+	pageOffsets.push_back(idx + 4 * pagesCount);
+	for (size_t i = 0; i < pagesCount; ++i) {
+		size_t pageEnd = pageOffsets.back() + readInt(compressedBytes, idx);
+
+		if (pageEnd > size) {
+			// throw exception("The given container is corrupted");
+			cerr << "The given container is corrupted" << endl;
+			pageOffsets.clear();
+			return false;
+		}
+
+		pageOffsets.push_back(pageEnd);
+	}
+
+	return true;
+}
+
+void DocumentCompressor::extractDictionary(const vector<uchar>& compressedBytes) {
+	size_t idx = 0;
+	size_t dictionarySize = readInt(compressedBytes, idx);
+
+	vector<uchar> dictionaryBytes(compressedBytes.begin() + idx, compressedBytes.begin() + idx + dictionarySize);
+	compressor.extractDictionary(dictionaryBytes, dictionary);
+}
+
+void DocumentCompressor::extractPage(const vector<uchar>& compressedBytes, const vector<size_t>& pageOffsets, int pageIdx, cv::Mat& outputPage) {
+	vector<uchar> pageBytes(compressedBytes.begin() + pageOffsets[pageIdx], compressedBytes.begin() + pageOffsets[pageIdx + 1]);
+
+	compressor.setDictionary(&dictionary);
+	compressor.extract(pageBytes, outputPage);
+	compressor.setDictionary(NULL);
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <cstdint>
+
+// OpenCV libraries
+#include <opencv2/core/core.hpp>
+
+// Custom libraries
+#include "Compressor.h"
+#include "ShapeDictionary.h"
+#include "ByteIO.h"
+
+using namespace std;
+
+typedef unsigned char uchar;
+
+/**
+ * Compressor of multi-page documents, the shapes found on several pages are stored
+ * once in a dictionary shared by all the pages, followed by the pages compressed
+ * separately so each page can be extracted on its own
+ */
+class DocumentCompressor
+{
+private:
+	const int MIN_SHARED_PAGES = 2;         // Minimum number of pages having a shape to store it in the dictionary
+
+	Compressor compressor;
+	ShapeDictionary dictionary;
+
+	// ==============================================================================
+	//
+	// Compression functions
+	//
+public:
+	/**
+	 * Compress the given black & white pages into a single container
+	 */
+	void compress(const vector<cv::Mat>& pages, vector<uchar>& outputBytes);
+
+	/**
+	 * Return the compressor of the pages, used to configure the compression
+	 */
+	Compressor& getCompressor();
+
+private:
+	/**
+	 * Store the shapes found on at least MIN_SHARED_PAGES pages in the dictionary,
+	 * keeping the detection results of each page to encode the pages
+	 */
+	void buildDictionary(const vector<cv::Mat>& pages, vector<ImageDetection>& detections);
+
+	// ==============================================================================
+	//
+	// Extraction functions
+	//
+public:
+	/**
+	 * Extract all the pages of the given container
+	 */
+	void extract(const vector<uchar>& compressedBytes, vector<cv::Mat>& outputPages);
+
+	/**
+	 * Extract the given page of the given container only
+	 */
+	void extractPage(const vector<uchar>& compressedBytes, int pageIdx, cv::Mat& outputPage);
+
+	/**
+	 * Return the number of pages of the given container
+	 */
+	int getPagesCount(const vector<uchar>& compressedBytes);
+
+private:
+	/**
+	 * Retrieve the start offset of each page of the given container followed by the end of
+	 * the last page, return false if the container is truncated
+	 */
+	bool readPagesTable(const vector<uchar>& compressedBytes, vector<size_t>& pageOffsets);
+
+	/**
+	 * Extract the dictionary of the given container, its size is already checked by readPagesTable
+	 */
+	void extractDictionary(const vector<uchar>& compressedBytes);
+
+	/**
+	 * Extract the given page of the given container using the extracted dictionary
+	 */
+	void extractPage(const vector<uchar>& compressedBytes, const vector<size_t>& pageOffsets, int pageIdx, cv::Mat& outputPage);
+};
@@ -0,0 +1,89 @@
+#include "FrequencyTable.h"
+
+void FrequencyTable::build(const vector<uchar>& data, int totalFrqBits) {
+	// Count the frequency of each symbol in the given data
+	symbolsFrq.assign(ALPHA_SIZE, 0);
+	for (int i = 0; i < data.size(); ++i) {
+		++symbolsFrq[data[i]];
+	}
+
+	normalizeFrequencies(data.size(), totalFrqBits);
+	calculatePrefixSum();
+}
+
+void FrequencyTable::encode(vector<uchar>& encodedData) {
+	BitConcatenator concat;
+	vector<uchar> metaData;
+	concat.concatenate(symbolsFrq, metaData);
+
+	int n = metaData.size();
+
+	if (n >= 1 << 16) {
+		// throw exception("Cannot encode the symbols frequencies");
+		cerr << "Cannot encode the symbols frequencies" << endl;
+	}
+
+	encodedData.push_back(n);
+	encodedData.push_back(n >> 8);
+	encodedData.insert(encodedData.end(), metaData.begin(), metaData.end());
+}
+
+int FrequencyTable::decode(const vector<uchar>& data) {
+	int n = 2;
+	n += data[0];
+	n += data[1] << 8;
+
+	BitConcatenator concat;
+	vector<uchar> metaData(data.begin() + 2, data.begin() + n);
+	symbolsFrq.clear();
+	concat.deconcatenate(metaData, symbolsFrq);
+
+	calculatePrefixSum();
+	return n;
+}
+
+void FrequencyTable::buildSlots(int totalFrqBits) {
+	slotSymbols.resize(1 << totalFrqBits);
+	for (int i = 0; i < ALPHA_SIZE; ++i) {
+		fill(slotSymbols.begin() + symbolsFrqPrefixSum[i], slotSymbols.begin() + symbolsFrqPrefixSum[i + 1], i);
+	}
+}
+
+void FrequencyTable::normalizeFrequencies(int dataSize, int totalFrqBits) {
+	int total = 1 << totalFrqBits;
+	int sum = 0;
+	int maxIdx = 0;
+
+	for (int i = 0; i < ALPHA_SIZE; ++i) {
+		if (symbolsFrq[i] == 0) continue;
+		symbolsFrq[i] = max(1LL, (long long)symbolsFrq[i] * total / dataSize);
+		sum += symbolsFrq[i];
+
+		if (symbolsFrq[i] > symbolsFrq[maxIdx])
+			maxIdx = i;
+	}
+
+	// Give the rounding error to the most frequent symbol if it can take it
+	if (symbolsFrq[maxIdx] + total - sum >= 1) {
+		symbolsFrq[maxIdx] += total - sum;
+		return;
+	}
+
+	// Otherwise take the excess one by one from the symbols that can spare it
+	while (sum > total) {
+		for (int i = 0; i < ALPHA_SIZE && sum > total; ++i) {
+			if (symbolsFrq[i] > 1) {
+				--symbolsFrq[i];
+				--sum;
+			}
+		}
+	}
+}
+
+void FrequencyTable::calculatePrefixSum() {
+	symbolsFrqPrefixSum.resize(ALPHA_SIZE + 1);
+	symbolsFrqPrefixSum[0] = 0;
+	for (int i = 1; i <= ALPHA_SIZE; ++i) {
+		symbolsFrqPrefixSum[i] = symbolsFrqPrefixSum[i - 1] + symbolsFrq[i - 1];
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include "BitConcatenator.h"
+using namespace std;
+
+typedef unsigned char uchar;
+
+/**
+ * Symbols frequencies of the static entropy coders normalized to a power of two total,
+ * stored in the coded data header and mapped back to the symbols when decoding
+ */
+class FrequencyTable
+{
+public:
+	static const int ALPHA_SIZE = 256;
+
+	vector<int> symbolsFrq;
+	vector<int> symbolsFrqPrefixSum;
+	vector<uchar> slotSymbols;					// Maps each cumulative frequency slot to its symbol
+
+	/**
+	 * Count the frequency of each symbol in the given data and scale the frequencies
+	 * to sum up to 2^totalFrqBits keeping every used symbol with a non-zero frequency
+	 */
+	void build(const vector<uchar>& data, int totalFrqBits);
+
+	/**
+	 * Append the frequencies to the given encoded data preceded by their size in 2 bytes
+	 */
+	void encode(vector<uchar>& encodedData);
+
+	/**
+	 * Retrieve the frequencies stored at the start of the given data,
+	 * return the number of header bytes read
+	 */
+	int decode(const vector<uchar>& data);
+
+	/**
+	 * Map each of the 2^totalFrqBits cumulative frequency slots to its symbol
+	 */
+	void buildSlots(int totalFrqBits);
+
+private:
+	void normalizeFrequencies(int dataSize, int totalFrqBits);
+
+	void calculatePrefixSum();
+};
@@ -4,7 +4,7 @@
 // Encoding functions
 //
 
-void Huffman::encode(const vector<uchar>& data, vector<uchar>& encodedData) {
+void Huffman::encode(const vector<uchar>& data, vector<uchar>& encodedData, int streamsCount) {
 	if (data.empty())
 		return;
 
@@ -15,85 +15,81 @@ void Huffman::encode(const vector<uchar>& data, vector<uchar>& encodedData) {
 	}
 
 	buildCodeTable();
-	//encodeCodeTable(encodedData);
-	encodeSymbols(encodedData);
 
-	uchar byte = 0;
-	int bitsCount = 8;
+	// Encode the number of streams
+	streamsCount = max(1, min(streamsCount, MAX_STREAMS));
+	encodedData.push_back(streamsCount);
 
-	for (int i = 0; i < data.size(); ++i) {
-		string& code = codeTable[data[i]];
+	if (streamsCount == 1)
+		encodeSingleStream(data, encodedData);
+	else
+		encodeMultiStream(data, encodedData, streamsCount);
+}
 
-		for (int j = 0; j < code.size(); ++j) {
-			byte |= (code[j] - '0') << --bitsCount;
+void Huffman::encodeSingleStream(const vector<uchar>& data, vector<uchar>& encodedData) {
+	BitWriter writer(encodedData);
+	encodeCodeLengths(writer);
 
-			if (bitsCount <= 0) {
-				encodedData.push_back(byte);
-				byte = 0;
-				bitsCount = 8;
-			}
-		}
+	for (int i = 0; i < data.size(); ++i) {
+		writer.writeBits(codeWords[data[i]], codeLengths[data[i]]);
 	}
 
-	if (bitsCount < 8) {
-		encodedData.push_back(byte);
-		encodedData.push_back(bitsCount);	// Number of bits to be ignored
-	}
-	else {
-		encodedData.push_back(0);			// Number of bits to be ignored
-	}
+	encodedData.push_back(writer.flush());	// Number of bits to be ignored
 }
 
-// [deprecated, encodeSymbols is used instead]
-void Huffman::encodeCodeTable(vector<uchar>& encodedData) {
-	// Encode number of distinct symbols
-	encodedData.push_back(codeTable.size() - 1);
+void Huffman::encodeMultiStream(const vector<uchar>& data, vector<uchar>& encodedData, int streamsCount) {
+	BitWriter writer(encodedData);
+	encodeCodeLengths(writer);
+	writer.flush();
 
-	// Loop through each symbol to encode the symbol and its code word length
-	for (auto it : codeTable) {
-		encodedData.push_back(it.first);
-		encodedData.push_back(it.second.size());
+	// Encode the symbols count
+	int n = data.size();
+	for (int k = 0; k < 4; ++k) {
+		encodedData.push_back(n >> (8 * k));
 	}
 
-	uchar byte = 0;
-	int bitsCount = 8;
+	// Encode the i-th symbol in the (i % streamsCount)-th stream
+	vector<vector<uchar>> streams(streamsCount);
+	for (int s = 0; s < streamsCount; ++s) {
+		BitWriter streamWriter(streams[s]);
 
-	// Loop through each symbol to encode its code word
-	for (auto it : codeTable) {
-		string& code = it.second;
+		for (int i = s; i < data.size(); i += streamsCount) {
+			streamWriter.writeBits(codeWords[data[i]], codeLengths[data[i]]);
+		}
 
-		for (int j = 0; j < code.size(); ++j) {
-			byte |= (code[j] - '0') << --bitsCount;
+		streamWriter.flush();
+	}
 
-			if (bitsCount <= 0) {
-				encodedData.push_back(byte);
-				byte = 0;
-				bitsCount = 8;
-			}
+	// Encode the jump table, the last stream ends at the end of the data
+	for (int s = 0; s + 1 < streamsCount; ++s) {
+		int size = streams[s].size();
+		for (int k = 0; k < 4; ++k) {
+			encodedData.push_back(size >> (8 * k));
 		}
 	}
 
-	if (bitsCount < 8) {
-		encodedData.push_back(byte);
+	for (int s = 0; s < streamsCount; ++s) {
+		encodedData.insert(encodedData.end(), streams[s].begin(), streams[s].end());
 	}
 }
 
-void Huffman::encodeSymbols(vector<uchar>& encodedData) {
-	BitConcatenator concat;
-	vector<uchar> metaData;
-	concat.concatenate(symbolsFrq, metaData);
+void Huffman::encodeCodeLengths(BitWriter& writer) {
+	for (int i = 0; i < ALPHA_SIZE; ) {
+		if (codeLengths[i] > 0) {
+			writer.writeBits(codeLengths[i++], 4);
+			continue;
+		}
 
-	int n = metaData.size();
+		// Encode a run of at most 16 unused symbols
+		int runCnt = 0;
+		while (i < ALPHA_SIZE && codeLengths[i] == 0 && runCnt < 16) {
+			++runCnt;
+			++i;
+		}
 
-	if (n >= 1 << 16) {
-		// Should never happens in "int" limit
-		// throw exception("Cannot encode Huffman meta-data");
-		cerr << "Cannot encode Huffman meta-data" << endl;
+		writer.writeBits(0, 4);
+		writer.writeBits(runCnt - 1, 4);
 	}
-
-	encodedData.push_back(n);
-	encodedData.push_back(n >> 8);
-	encodedData.insert(encodedData.end(), metaData.begin(), metaData.end());
 }
 
 // ==============================================================================
@@ -102,74 +98,145 @@ void Huffman::encodeSymbols(vector<uchar>& encodedData) {
 //
 
 void Huffman::decode(const vector<uchar>& data, vector<uchar>& decodedData) {
-	decodeSymbols(data);
-	//decodeCodeTable(data);
-	buildCodeTable();
+	if (data.empty())
+		return;
 
-	// Convert data to binary string
-	string binaryStr;
-	while (dataIdx + 2 < data.size()) {
-		binaryStr += byteToBinaryString(data[++dataIdx]);
-	}
-	int ignoreCount = data.back();
-	binaryStr.erase(binaryStr.size() - ignoreCount, binaryStr.size());
+	int streamsCount = data[0];
+
+	if (streamsCount == 1)
+		decodeSingleStream(data, decodedData);
+	else
+		decodeMultiStream(data, decodedData, streamsCount);
+}
+
+void Huffman::decodeSingleStream(const vector<uchar>& data, vector<uchar>& decodedData) {
+	// The first byte holds the number of streams and the last one holds the number of bits to be ignored
+	BitReader reader(data.data() + 1, data.size() - 2);
+	long long bitsLeft = 8LL * ((long long)data.size() - 2) - data.back();
+
+	bitsLeft -= decodeCodeLengths(reader);
+	buildCanonicalCodes();
+	buildDecodingTables();
 
-	// Detect code words and map them to their corresponding symbol
-	string code;
-	for (int i = 0; i < binaryStr.size(); ++i) {
-		code += binaryStr[i];
+	while (bitsLeft > 0) {
+		uchar symbol;
+		int len = decodeSymbol(reader, symbol);
 
-		if (codeTableInverse.count(code)) {
-			decodedData.push_back(codeTableInverse[code]);
-			code.clear();
+		if (len == 0) {
+			// throw exception("Invalid Huffman code word");
+			cerr << "Invalid Huffman code word" << endl;
+			return;
 		}
+
+		decodedData.push_back(symbol);
+		bitsLeft -= len;
 	}
 }
 
-// [deprecated, decodeSymbols is used instead]
-void Huffman::decodeCodeTable(const vector<uchar>& data) {
-	dataIdx = -1;
+void Huffman::decodeMultiStream(const vector<uchar>& data, vector<uchar>& decodedData, int streamsCount) {
+	// Decode the code word lengths which are padded to a byte boundary
+	BitReader headerReader(data.data() + 1, data.size() - 1);
+	int dataIdx = 1 + (decodeCodeLengths(headerReader) + 7) / 8;
+	buildCanonicalCodes();
+	buildDecodingTables();
+
+	// Decode the symbols count
+	int n = 0;
+	for (int k = 0; k < 4; ++k) {
+		n |= data[dataIdx++] << (8 * k);
+	}
 
-	// Decode distinct symbols size
-	int symbolsCount = data[++dataIdx] + 1;
+	// Decode the jump table and prepare a reader for each stream
+	vector<int> streamStart(streamsCount + 1);
+	streamStart[0] = dataIdx + 4 * (streamsCount - 1);
+	for (int s = 0; s + 1 < streamsCount; ++s) {
+		int size = 0;
+		for (int k = 0; k < 4; ++k) {
+			size |= data[dataIdx++] << (8 * k);
+		}
+		streamStart[s + 1] = streamStart[s] + size;
+	}
+	streamStart[streamsCount] = data.size();
 
-	// Decode the symbols and their code word lengths
-	int totalCodewordLengths = 0;
-	vector<pair<uchar, int>> symbols(symbolsCount);
-	for (int i = 0; i < symbolsCount; ++i) {
-		symbols[i].first = data[++dataIdx];
-		symbols[i].second = data[++dataIdx];
-		totalCodewordLengths += symbols[i].second;
+	if (streamStart[streamsCount - 1] > data.size()) {
+		// throw exception("Invalid Huffman jump table");
+		cerr << "Invalid Huffman jump table" << endl;
+		return;
 	}
 
-	// Loop to get all distinct code words concatenated together
-	string codewords;
-	int codewordsBytesCount = (totalCodewordLengths + 7) / 8;	// ceil(totalCodewordLengths / 8)
-	for (int i = 0; i < codewordsBytesCount; ++i) {
-		codewords += byteToBinaryString(data[++dataIdx]);
+	vector<BitReader> readers;
+	for (int s = 0; s < streamsCount; ++s) {
+		readers.push_back(BitReader(data.data() + streamStart[s], streamStart[s + 1] - streamStart[s]));
 	}
 
-	// Build Huffman code word table by spliting the previous string accourding to the lengths
-	// of the code words
-	int l = 0;
-	for (int i = 0; i < symbolsCount; ++i) {
-		int len = symbols[i].second;
-		codeTable[symbols[i].first] = codewords.substr(l, len);
-		codeTableInverse[codewords.substr(l, len)] = symbols[i].first;
-		l += len;
+	// Decode one symbol from each stream per round, the streams are independent
+	// so their table lookups overlap instead of waiting on each other
+	int offset = decodedData.size();
+	decodedData.resize(offset + n);
+	uchar* output = decodedData.data() + offset;
+
+	int roundsCount = n / streamsCount;
+	bool valid = true;
+	for (int r = 0; r < roundsCount; ++r) {
+		for (int s = 0; s < streamsCount; ++s) {
+			valid &= (decodeSymbol(readers[s], output[r * streamsCount + s]) > 0);
+		}
 	}
+	for (int i = roundsCount * streamsCount; i < n; ++i) {
+		valid &= (decodeSymbol(readers[i % streamsCount], output[i]) > 0);
+	}
+
+	if (!valid) {
+		// throw exception("Invalid Huffman code word");
+		cerr << "Invalid Huffman code word" << endl;
+	}
+}
+
+int Huffman::decodeCodeLengths(BitReader& reader) {
+	int bitsCount = 0;
+
+	codeLengths.assign(ALPHA_SIZE, 0);
+	for (int i = 0; i < ALPHA_SIZE; ) {
+		int len = (int)reader.readBits(4);
+		bitsCount += 4;
+
+		if (len > 0) {
+			codeLengths[i++] = len;
+			continue;
+		}
+
+		// Skip a run of unused symbols
+		i += (int)reader.readBits(4) + 1;
+		bitsCount += 4;
+	}
+
+	return bitsCount;
 }
 
-void Huffman::decodeSymbols(const vector<uchar>& data) {
-	int n = 2;
-	n += data[0];
-	n += data[1] << 8;
+int Huffman::decodeSymbol(BitReader& reader, uchar& symbol) {
+	// Resolve short code words directly from the primary table
+	uint16_t entry = lookupTable[reader.peekBits(LOOKUP_BITS)];
+	int len = entry & 255;
+	symbol = entry >> 8;
 
-	dataIdx = n - 1;
+	// Resolve long code words using the canonical code properties
+	if (len == 0) {
+		for (len = LOOKUP_BITS + 1; len <= maxCodeLength; ++len) {
+			int code = (int)reader.peekBits(len);
 
-	BitConcatenator concat;
-	vector<uchar> metaData(data.begin() + 2, data.begin() + n);
-	concat.deconcatenate(metaData, symbolsFrq);
+			if (code - firstCode[len] >= 0 && code - firstCode[len] < lengthCount[len]) {
+				symbol = sortedSymbols[firstSymbolIdx[len] + (code - firstCode[len])];
+				break;
+			}
+		}
+
+		if (len > maxCodeLength) {
+			return 0;
+		}
+	}
+
+	reader.skipBits(len);
+	return len;
 }
 
 // ==============================================================================
@@ -178,86 +245,198 @@ void Huffman::decodeSymbols(const vector<uchar>& data) {
 //
 
 void Huffman::buildCodeTable() {
-	// Populate symbols multiset sorted in non-decreasing order
-	multiset<pair<int, SymbolNode*>> symbols;
+	// Sort the used symbols in non-decreasing order of their frequencies
+	int symbols[ALPHA_SIZE];
+	int lengths[ALPHA_SIZE];
+	int symbolsCount = 0;
+
 	for (int i = 0; i < ALPHA_SIZE; ++i) {
 		if (symbolsFrq[i] == 0) continue;
-		SymbolNode* n = new SymbolNode();
-		n->symbol = i;
-		symbols.insert({ symbolsFrq[i], n });
-	}
-
-	// Build the tree
-	while (symbols.size() > 1) {
-		int freq = 0;
-		SymbolNode* n = new SymbolNode();
-
-		//
-		// Combine the least frequent two nodes into one node
-		//
-		// First node
-		freq += symbols.begin()->first;
-		n->left = symbols.begin()->second;
-		symbols.erase(symbols.begin());
-		// Second node
-		freq += symbols.begin()->first;
-		n->right = symbols.begin()->second;
-		symbols.erase(symbols.begin());
-
-		// Insert the combined node
-		symbols.insert({ freq, n });
-	}
-
-	// Traverse the tree to generate the code table
-	if (symbols.size() == 1) {
-		SymbolNode* root = symbols.begin()->second;
-		traverseTree(root);
-		deleteTree(root);
+		symbols[symbolsCount++] = i;
+	}
+
+	sort(symbols, symbols + symbolsCount, [this](int lhs, int rhs) {
+		return symbolsFrq[lhs] < symbolsFrq[rhs] || (symbolsFrq[lhs] == symbolsFrq[rhs] && lhs < rhs);
+	});
+
+	for (int i = 0; i < symbolsCount; ++i) {
+		lengths[i] = symbolsFrq[symbols[i]];
+	}
+
+	// Replace the frequencies by the code word lengths
+	calculateCodeLengths(lengths, symbolsCount);
+	limitCodeLengths(lengths, symbolsCount);
+
+	codeLengths.assign(ALPHA_SIZE, 0);
+	for (int i = 0; i < symbolsCount; ++i) {
+		codeLengths[symbols[i]] = lengths[i];
 	}
+
+	buildCanonicalCodes();
 }
 
-void Huffman::traverseTree(SymbolNode* node, string code) {
-	if (node->left != NULL) {
-		traverseTree(node->left, code + "0");
+void Huffman::calculateCodeLengths(int* A, int n) {
+	if (n == 0)
+		return;
+
+	// A single symbol still needs a one bit code word
+	if (n == 1) {
+		A[0] = 1;
+		return;
 	}
-	if (node->right != NULL) {
-		traverseTree(node->right, code + "1");
+
+	// First pass, left to right, merge the two least weighted items (a leaf from A[leaf..]
+	// or an internal node from A[root..next - 1]) into the internal node A[next],
+	// leaving parent pointers in the merged internal nodes
+	A[0] += A[1];
+	int root = 0, leaf = 2, next;
+
+	for (next = 1; next < n - 1; ++next) {
+		// First item
+		if (leaf >= n || A[root] < A[leaf]) {
+			A[next] = A[root];
+			A[root++] = next;
+		}
+		else {
+			A[next] = A[leaf++];
+		}
+
+		// Second item
+		if (leaf >= n || (root < next && A[root] < A[leaf])) {
+			A[next] += A[root];
+			A[root++] = next;
+		}
+		else {
+			A[next] += A[leaf++];
+		}
 	}
 
-	// If the current node is a leaf node then insert its code into the table
-	if (node->left == NULL && node->left == NULL) {
-		codeTable.insert({ node->symbol, code });
-		codeTableInverse.insert({ code, node->symbol });
+	// Second pass, right to left, convert the parent pointers to internal node depths
+	A[n - 2] = 0;
+	for (next = n - 3; next >= 0; --next) {
+		A[next] = A[A[next]] + 1;
+	}
+
+	// Third pass, right to left, convert the internal node depths to leaf depths
+	int available = 1, used = 0, depth = 0;
+	root = n - 2;
+	next = n - 1;
+
+	while (available > 0) {
+		while (root >= 0 && A[root] == depth) {
+			++used;
+			--root;
+		}
+		while (available > used) {
+			A[next--] = depth;
+			--available;
+		}
+
+		available = 2 * used;
+		++depth;
+		used = 0;
 	}
 }
 
-string Huffman::byteToBinaryString(uchar byte) {
-	string result;
-	for (int i = 7; i >= 0; --i) {
-		result += '0' + (bool)(byte & (1 << i));
+void Huffman::limitCodeLengths(int* lengths, int n) {
+	if (n == 0 || lengths[0] <= MAX_CODE_LENGTH)
+		return;
+
+	// Count the code words of each length after clamping the long ones
+	int count[MAX_CODE_LENGTH + 1] = { 0 };
+	for (int i = 0; i < n; ++i) {
+		++count[min(lengths[i], (int)MAX_CODE_LENGTH)];
+	}
+
+	// Clamping breaks the Kraft inequality, so repeatedly move a code word of the maximum
+	// length one level up under a shorter leaf until the prefix code is complete again
+	long long kraftSum = 0;
+	for (int len = 1; len <= MAX_CODE_LENGTH; ++len) {
+		kraftSum += (long long)count[len] << (MAX_CODE_LENGTH - len);
+	}
+
+	while (kraftSum > (1LL << MAX_CODE_LENGTH)) {
+		--count[MAX_CODE_LENGTH];
+
+		for (int len = MAX_CODE_LENGTH - 1; len > 0; --len) {
+			if (count[len] > 0) {
+				--count[len];
+				count[len + 1] += 2;
+				break;
+			}
+		}
+
+		--kraftSum;
+	}
+
+	// Re-assign the lengths, the shortest ones go to the most frequent symbols
+	for (int len = 1, i = n - 1; len <= MAX_CODE_LENGTH; ++len) {
+		for (int j = 0; j < count[len]; ++j) {
+			lengths[i--] = len;
+		}
 	}
-	return result;
 }
 
-void Huffman::printCodeTable(string path) {
-	ofstream fout(path);
+void Huffman::buildCanonicalCodes() {
+	// Count the code words of each length
+	maxCodeLength = 0;
+	for (int i = 0; i < ALPHA_SIZE; ++i) {
+		maxCodeLength = max(maxCodeLength, codeLengths[i]);
+	}
 
-	for (auto it : codeTable) {
-		fout << (int)it.first << "\t" << it.second << endl;
+	lengthCount.assign(maxCodeLength + 1, 0);
+	for (int i = 0; i < ALPHA_SIZE; ++i) {
+		++lengthCount[codeLengths[i]];
+	}
+	lengthCount[0] = 0;
+
+	// Compute the first code word and the first symbol index of each length
+	firstCode.assign(maxCodeLength + 1, 0);
+	firstSymbolIdx.assign(maxCodeLength + 1, 0);
+	for (int len = 1; len <= maxCodeLength; ++len) {
+		firstCode[len] = (firstCode[len - 1] + lengthCount[len - 1]) << 1;
+		firstSymbolIdx[len] = firstSymbolIdx[len - 1] + lengthCount[len - 1];
 	}
 
-	fout.close();
+	// Assign consecutive code words to the symbols of the same length in symbol order
+	vector<int> nextSymbolIdx(firstSymbolIdx);
+	sortedSymbols.resize(firstSymbolIdx[maxCodeLength] + lengthCount[maxCodeLength]);
+	codeWords.assign(ALPHA_SIZE, 0);
+	for (int i = 0; i < ALPHA_SIZE; ++i) {
+		int len = codeLengths[i];
+		if (len == 0) continue;
+		codeWords[i] = firstCode[len] + (nextSymbolIdx[len] - firstSymbolIdx[len]);
+		sortedSymbols[nextSymbolIdx[len]++] = i;
+	}
 }
 
-void Huffman::deleteTree(SymbolNode* node) {
-	if (node == NULL)
-		return;
+void Huffman::buildDecodingTables() {
+	// Fill all the table entries prefixed by each short code word
+	lookupTable.assign(1 << LOOKUP_BITS, 0);
+	for (int i = 0; i < ALPHA_SIZE; ++i) {
+		int len = codeLengths[i];
+		if (len == 0 || len > LOOKUP_BITS) continue;
 
-	deleteTree(node->left);
-	deleteTree(node->right);
-	delete node;
+		int first = codeWords[i] << (LOOKUP_BITS - len);
+		int count = 1 << (LOOKUP_BITS - len);
+		for (int j = 0; j < count; ++j) {
+			lookupTable[first + j] = (i << 8) | len;
+		}
+	}
 }
 
-bool operator<(const pair<int, SymbolNode*>& lhs, const pair<int, SymbolNode*> rhs) {
-	return lhs.first < rhs.first;
+void Huffman::printCodeTable(string path) {
+	ofstream fout(path);
+
+	for (int i = 0; i < ALPHA_SIZE; ++i) {
+		if (codeLengths[i] == 0) continue;
+
+		string code;
+		for (int j = codeLengths[i] - 1; j >= 0; --j) {
+			code += '0' + (int)((codeWords[i] >> j) & 1);
+		}
+		fout << i << "\t" << code << endl;
+	}
+
+	fout.close();
 }
\ No newline at end of file
@@ -3,32 +3,34 @@
 #include <fstream>
 #include <string>
 #include <vector>
-#include <map>
-#include <set>
-#include "BitConcatenator.h"
+#include <algorithm>
+#include <cstdint>
+#include "BitStream.h"
 using namespace std;
 
 typedef unsigned char uchar;
 
-/**
- * Node structure needed to build Huffman tree
- */
-struct SymbolNode {
-	uchar symbol;
-	SymbolNode* left = NULL;
-	SymbolNode* right = NULL;
-};
-
 class Huffman
 {
 private:
-	const int ALPHA_SIZE = 256;
+	static const int ALPHA_SIZE = 256;
+	static const int MAX_CODE_LENGTH = 15;	// Maximum code word length, fits in the 4-bit code length fields
+	const int LOOKUP_BITS = 11;		// Number of bits resolved by the primary decoding table
+	const int MAX_STREAMS = 255;	// Maximum number of interleaved bit streams
 
-	int dataIdx;
-	string encodedData;
 	vector<int> symbolsFrq;
-	map<uchar, string> codeTable;
-	map<string, uchar> codeTableInverse;
+
+	// Canonical code table
+	int maxCodeLength;
+	vector<int> codeLengths;		// Code word length of each symbol (0 if the symbol is not used)
+	vector<int> codeWords;			// Canonical code word of each symbol
+
+	// Canonical decoding tables
+	vector<uint16_t> lookupTable;	// Maps the next LOOKUP_BITS bits to (symbol << 8 | length), 0 if longer
+	vector<uchar> sortedSymbols;	// Symbols sorted by code word length then by value
+	vector<int> firstCode;			// First canonical code word of each length
+	vector<int> firstSymbolIdx;		// Index in sortedSymbols of the first symbol of each length
+	vector<int> lengthCount;		// Number of code words of each length
 
 	// ==============================================================================
 	//
@@ -37,15 +39,29 @@ private:
 public:	
 	/**
 	 * Encode the passed data by generating shorter code words for
-	 * more frequent symbols
+	 * more frequent symbols, the symbols are distributed in round robin order
+	 * over the given number of independent bit streams so that they can be decoded
+	 * in parallel
 	 */
-	void encode(const vector<uchar>& data, vector<uchar>& encodedData);
+	void encode(const vector<uchar>& data, vector<uchar>& encodedData, int streamsCount = 1);
 
 private:
-	// [deprecated, encodeSymbols is used instead]
-	void encodeCodeTable(vector<uchar>& encodedData);
+	/**
+	 * Encode the symbols in a single bit stream shared with the code word lengths
+	 */
+	void encodeSingleStream(const vector<uchar>& data, vector<uchar>& encodedData);
+
+	/**
+	 * Encode the symbols in interleaved bit streams preceded by a jump table
+	 * holding the size of each stream
+	 */
+	void encodeMultiStream(const vector<uchar>& data, vector<uchar>& encodedData, int streamsCount);
 
-	void encodeSymbols(vector<uchar>& encodedData);
+	/**
+	 * Encode the code word length of each symbol in 4 bits,
+	 * runs of unused symbols are encoded as a zero length followed by the run length
+	 */
+	void encodeCodeLengths(BitWriter& writer);
 
 	// ==============================================================================
 	//
@@ -59,10 +75,20 @@ public:
 	void decode(const vector<uchar>& data, vector<uchar>& decodedData);
 
 private:
-	// [deprecated, decodeSymbols is used instead]
-	void decodeCodeTable(const vector<uchar>& data);
+	void decodeSingleStream(const vector<uchar>& data, vector<uchar>& decodedData);
 
-	void decodeSymbols(const vector<uchar>& data);
+	void decodeMultiStream(const vector<uchar>& data, vector<uchar>& decodedData, int streamsCount);
+
+	/**
+	 * Decode the code word length of each symbol and return the number of bits read
+	 */
+	int decodeCodeLengths(BitReader& reader);
+
+	/**
+	 * Decode the next symbol of the given bit stream and return its code word length,
+	 * or 0 if the stream holds an invalid code word
+	 */
+	int decodeSymbol(BitReader& reader, uchar& symbol);
 
 	//
 	// Helper functions
@@ -70,11 +96,27 @@ private:
 private:
 	void buildCodeTable();
 
-	void traverseTree(SymbolNode* node, string code = "");
+	/**
+	 * Replace the given non-decreasing frequencies by their Huffman code word lengths in place
+	 * using Moffat-Katajainen algorithm, without building the tree
+	 */
+	void calculateCodeLengths(int* A, int n);
 
-	string byteToBinaryString(uchar byte);
+	/**
+	 * Limit the given non-increasing code word lengths to MAX_CODE_LENGTH while keeping
+	 * a complete prefix code, the longer code words still go to the less frequent symbols
+	 */
+	void limitCodeLengths(int* lengths, int n);
 
-	void printCodeTable(string path);
+	/**
+	 * Assign canonical code words to the symbols according to their code word lengths
+	 */
+	void buildCanonicalCodes();
+
+	/**
+	 * Build the lookup tables used to resolve the canonical code words when decoding
+	 */
+	void buildDecodingTables();
 
-	void deleteTree(SymbolNode* node);
+	void printCodeTable(string path);
 };
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+#include <algorithm>
+
+// OpenCV libraries
+#include <opencv2/core/core.hpp>
+
+// Custom libraries
+#include "Bitmap.h"
+
+using namespace std;
+
+/**
+ * Source of the rows of a black & white image, used to compress
+ * images too large to be held in memory at once in horizontal stripes
+ */
+class RowSource
+{
+public:
+	virtual ~RowSource() {}
+
+	/**
+	 * Read at most "count" next rows of the image into the given matrix,
+	 * and return the number of read rows or zero when all the rows are read
+	 */
+	virtual int readRows(int count, cv::Mat& stripe) = 0;
+
+	/**
+	 * Return the dominant color of the image (0 or 255) if it is known before reading the rows,
+	 * otherwise return -1 and the dominant color is detected from the first stripe
+	 */
+	virtual int getDominantColor() {
+		return -1;
+	}
+};
+
+/**
+ * Row source reading the rows of an image already loaded in memory
+ */
+class MatRowSource : public RowSource
+{
+private:
+	cv::Mat imageMat;
+	int nextRow = 0;
+
+public:
+	MatRowSource(const cv::Mat& imageMat) : imageMat(imageMat) {}
+
+	int readRows(int count, cv::Mat& stripe) {
+		count = min(count, imageMat.rows - nextRow);
+
+		if (count > 0) {
+			stripe = imageMat.rowRange(nextRow, nextRow + count);
+			nextRow += count;
+		}
+
+		return max(count, 0);
+	}
+
+	int getDominantColor() {
+		// Count the white pixels the same way as compressing the image at once
+		long long whiteCnt = Bitmap(imageMat, 0).countSet();
+
+		return (whiteCnt * 2 > (long long)imageMat.rows * imageMat.cols ? 255 : 0);
+	}
+};
@@ -0,0 +1,50 @@
+#include "ShapeDictionary.h"
+
+int ShapeDictionary::find(const Bitmap& shape, uint64_t hash) const {
+	unordered_map<uint64_t, vector<int>>::const_iterator it = shapesIndex.find(hash);
+
+	if (it == shapesIndex.end()) {
+		return -1;
+	}
+
+	for (int i = 0; i < it->second.size(); ++i) {
+		if (shape == shapes[it->second[i]])
+			return it->second[i];
+	}
+
+	return -1;
+}
+
+int ShapeDictionary::add(const Bitmap& shape) {
+	uint64_t hash = shape.hash();
+	int idx = find(shape, hash);
+
+	if (idx == -1) {
+		idx = shapes.size();
+		shapes.push_back(shape);
+		shapesIndex[hash].push_back(idx);
+	}
+
+	return idx;
+}
+
+int ShapeDictionary::size() const {
+	return shapes.size();
+}
+
+uint32_t ShapeDictionary::getId() const {
+	return id;
+}
+
+void ShapeDictionary::updateId() {
+	// FNV-1a hash of the shapes hashes, kept positive and non-zero
+	uint64_t hash = 14695981039346656037ULL;
+	const uint64_t prime = 1099511628211ULL;
+
+	for (int i = 0; i < shapes.size(); ++i) {
+		hash = (hash ^ shapes[i].hash()) * prime;
+	}
+
+	id = (uint32_t)((hash ^ (hash >> 32)) & 0x7FFFFFFF);
+	id += (id == 0);
+}
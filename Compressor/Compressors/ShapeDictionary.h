@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "Bitmap.h"
+using namespace std;
+
+/**
+ * Dictionary of distinct shapes shared by several images, the images refer
+ * to its shapes by their indecies instead of encoding them again
+ */
+class ShapeDictionary
+{
+public:
+	vector<Bitmap> shapes;
+
+private:
+	uint32_t id = 0;
+	unordered_map<uint64_t, vector<int>> shapesIndex;   // Maps shape size and content hash to the shapes having them
+
+public:
+	/**
+	 * Return the index of the given shape having the given hash, or -1 if not found
+	 */
+	int find(const Bitmap& shape, uint64_t hash) const;
+
+	/**
+	 * Add the given shape if not already added and return its index
+	 */
+	int add(const Bitmap& shape);
+
+	/**
+	 * Return the number of shapes of the dictionary
+	 */
+	int size() const;
+
+	/**
+	 * Return the identifier of the dictionary, which is a 31-bit hash of its shapes
+	 */
+	uint32_t getId() const;
+
+	/**
+	 * Compute the dictionary identifier after adding all of its shapes
+	 */
+	void updateId();
+};
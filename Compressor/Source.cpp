@@ -1,12 +1,23 @@
 // STL libraries
 #include <iostream>
+#include <sstream>
 #include <string>
-#include <ctime>
+#include <chrono>
 #include <iomanip>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <map>
+#include <climits>
 
 // Custom libraries
 #include "Utilities/Directory.h"
 #include "Utilities/Utility.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/BoundedQueue.h"
+#include "Utilities/Verification.h"
 #include "Compressors/Compressor.h"
 using namespace std;
 
@@ -17,6 +28,63 @@ using namespace std;
 #define EXT_SAMPLE_FILE         "jpg"
 #define EXT_COMPRESSED_FILE     "bit"
 
+// Batch configuration
+#define THREADS_COUNT           0       // Number of files compressed at once, zero for the hardware threads count
+#define LOAD_THREADS_COUNT      2       // Number of images loaded at once
+#define QUEUE_CAPACITY          4       // Maximum number of loaded files waiting in the load queue, and again in the pool queues
+#define VERIFY_ROUND_TRIP       true    // Extract each compressed file and compare it with the original image
+#define VERIFY_OPTIONS          false   // Also verify the round trip of each image using the non-default compression options, much slower
+
+/**
+ * File passed through the pipeline stages with its console messages
+ */
+struct FileJob {
+	int idx = 0;
+	string name;                            // Path relative to the samples directory without the extension
+	cv::Mat originalImg;
+	cv::Mat uncompressedImg;
+	vector<uchar> compressedBytes;
+	string log;
+};
+
+/**
+ * Statistics and console messages of a finished file
+ */
+struct FileResult {
+	long long originalSize = 0;
+	long long compressedSize = 0;
+	string log;
+};
+
+/**
+ * Shared state of the batch, the loaders pass the loaded images through the single bounded
+ * load queue to the main thread, which gives each file to the thread pool as one task that
+ * compresses, writes and verifies it; there is no separate write stage as the pool tasks
+ * write their own files, and only a limited number of files are given to the pool at once
+ * so only a limited number of images are held in memory
+ */
+struct Pipeline {
+	DirectoryWalker samples;                // The sample files are found as the loaders need them
+	mutex samplesLock;
+	int filesCount = 0;
+	BoundedQueue<FileJob> loadedFiles;
+	ThreadPool* pool = NULL;                // Runs the file tasks and the parallel parts of the verified options
+	atomic<int> activeLoaders;
+	atomic<int> firstLossyFile;             // The batch stops at the first lossy compressed file
+
+	mutex filesLock;
+	condition_variable fileFinished;
+	int activeFiles = 0;                    // Number of files given to the pool and not finished yet
+	map<int, FileResult> results;           // Finished files waiting for the earlier files to be printed
+	int nextPrintedFile = 0;
+	long long originalFilesSize = 0;
+	long long compressedFilesSize = 0;
+
+	Pipeline(int loadersCount) :
+		samples(PATH_SAMPLE_DATA, string("*.") + EXT_SAMPLE_FILE),
+		loadedFiles(QUEUE_CAPACITY), activeLoaders(loadersCount), firstLossyFile(INT_MAX) {}
+};
+
 /**
  * Used to boost reading/writing from/to the console
  */
@@ -27,89 +95,217 @@ inline void boostIO() {
 }
 
 /**
- * Main function
+ * Claim the next sample file in the walking order, return false when all the files
+ * are claimed or the batch is stopped
  */
-int main() {
-	boostIO();
-	int startTime = clock();
-	long long originalFilesSize = 0;
-	long long compressedFilesSize = 0;
-	vector<pair<string, string>> files;
+bool claimFile(Pipeline& pipeline, FileJob& job) {
+	lock_guard<mutex> guard(pipeline.samplesLock);
+	string path;
 
-	cout << fixed << setprecision(3);
-	
-	try {
-		// Read files info
-		getFilesInDirectory(PATH_SAMPLE_DATA, files);
-
-		for (int i = 0; i < files.size(); ++i) {
-			// If file is not of type .jpg then skip it
-			if (files[i].second != EXT_SAMPLE_FILE) {
-				continue;
-			}
+	if (pipeline.filesCount > pipeline.firstLossyFile || !pipeline.samples.next(path))
+		return false;
 
-			// Get file pathes
-			string src = PATH_SAMPLE_DATA + files[i].first + "." + EXT_SAMPLE_FILE;
-			string bit = PATH_COMPRESSED_DATA + files[i].first + "." + EXT_COMPRESSED_FILE;
-			string dst = PATH_UNCOMPRESSED_DATA + files[i].first + "." + EXT_SAMPLE_FILE;
+	job.idx = pipeline.filesCount++;
+	job.name = path.substr(0, path.size() - strlen(EXT_SAMPLE_FILE) - 1);
+	return true;
+}
 
-			// Compression variables
-			Compressor compressor;
-			cv::Mat originalImg, uncompressedImg;
-			vector<uchar> compressedBytes;
+/**
+ * Load and threshold the next unclaimed images and pass them to be compressed
+ */
+void loadStage(Pipeline& pipeline) {
+	FileJob job;
 
+	while (claimFile(pipeline, job)) {
+		try {
 			// Loading image
-			cout << "Loading " << src << "..." << endl;
-			originalImg = loadBinaryImage(src);
-			int orgSize = originalImg.rows * originalImg.cols;
-			originalFilesSize += orgSize;
+			string src = PATH_SAMPLE_DATA + job.name + "." + EXT_SAMPLE_FILE;
+			job.log += "Loading " + src + "...\n";
+			job.originalImg = loadBinaryImage(src);
+		}
+		catch (const exception& ex) {
+			job.log += string("ERROR::") + ex.what() + "\n";
+		}
+
+		// Wait while the files are compressed slower than loaded
+		if (!pipeline.loadedFiles.push(move(job)))
+			break;
+
+		job = FileJob();
+	}
+
+	// The last loader closes the queue
+	if (--pipeline.activeLoaders == 0)
+		pipeline.loadedFiles.close();
+}
+
+/**
+ * Store the result of the given finished file and print the results
+ * in the files order as they are finished
+ */
+void finishFile(Pipeline& pipeline, int idx, FileResult& result) {
+	lock_guard<mutex> guard(pipeline.filesLock);
+
+	pipeline.results[idx] = move(result);
+
+	for (map<int, FileResult>::iterator it = pipeline.results.begin(); it != pipeline.results.end() && it->first == pipeline.nextPrintedFile && pipeline.nextPrintedFile <= pipeline.firstLossyFile; it = pipeline.results.erase(it)) {
+		cout << it->second.log << flush;
+		pipeline.originalFilesSize += it->second.originalSize;
+		pipeline.compressedFilesSize += it->second.compressedSize;
+		pipeline.nextPrintedFile++;
+	}
+
+	pipeline.activeFiles--;
+	pipeline.fileFinished.notify_one();
+}
+
+/**
+ * Compress the given loaded image and save the compressed file, then if enabled load
+ * the saved file back, extract it and compare it with the image, run as a task of the thread pool
+ */
+void processFile(Pipeline& pipeline, FileJob& job) {
+	FileResult result;
+	ostringstream log;
+	log << fixed << setprecision(3) << job.log;
+
+	// Skip the files after a lossy compressed one as the batch stops there
+	if (job.idx <= pipeline.firstLossyFile) {
+		try {
+			Compressor compressor;
+			bool lossy = false;
+
+			string bit = PATH_COMPRESSED_DATA + job.name + "." + EXT_COMPRESSED_FILE;
+			string dst = PATH_UNCOMPRESSED_DATA + job.name + "." + EXT_SAMPLE_FILE;
+
+			// Mirror the sub-directories of the sample files
+			createParentDirectory(bit);
+			createParentDirectory(dst);
 
 			// Compressing
-			cout << "Compressing..." << endl;
-			compressor.compress(originalImg, compressedBytes);
-			int comSize = compressedBytes.size();
-			compressedFilesSize += comSize;
+			log << "Compressing..." << endl;
+			compressor.compress(job.originalImg, job.compressedBytes);
+			long long comSize = job.compressedBytes.size();
 
 			// Saving compressed image
-			cout << "Saving compressed file..." << endl;
-			saveFile(bit, compressedBytes);
-			
-			// ======================================================================
-
-			// Loading file
-			cout << "Loading compressed file..." << endl;
-			loadFile(bit, compressedBytes);
-
-			// Extracting
-			cout << "Extracting..." << endl;
-			compressor.extract(compressedBytes, uncompressedImg);
-
-			// Saving extracted image
-			cout << "Saving image..." << endl;
-			imwrite(dst, uncompressedImg);
-
-			// Stop if invalid compression is detected
-			cout << "Comparing original and compressed images..." << endl;
-			if (!compareImages(originalImg, uncompressedImg)) {
-				cout << "Lossy compression!" << endl;
-				return 0;
+			log << "Saving compressed file..." << endl;
+			saveFile(bit, job.compressedBytes);
+
+			if (VERIFY_ROUND_TRIP) {
+				// Loading file
+				log << "Loading compressed file..." << endl;
+				loadFile(bit, job.compressedBytes);
+
+				// Extracting
+				log << "Extracting..." << endl;
+				compressor.extract(job.compressedBytes, job.uncompressedImg);
+
+				// Saving extracted image
+				log << "Saving image..." << endl;
+				imwrite(dst, job.uncompressedImg);
+
+				// Stop if invalid compression is detected
+				log << "Comparing original and compressed images..." << endl;
+				lossy = !compareImages(job.originalImg, job.uncompressedImg);
+
+				if (VERIFY_OPTIONS && !lossy) {
+					// Verifying the other compression options
+					log << "Verifying compression options..." << endl;
+
+					string failedOption;
+					lossy = !verifyOptions(job.originalImg, failedOption, pipeline.pool);
+
+					if (lossy)
+						log << "Failed compression option: " << failedOption << endl;
+				}
+			}
+
+			if (lossy) {
+				log << "Lossy compression!" << endl;
+
+				int lossyFile = pipeline.firstLossyFile;
+				while (job.idx < lossyFile && !pipeline.firstLossyFile.compare_exchange_weak(lossyFile, job.idx));
+			}
+			else {
+				long long orgSize = (long long)job.originalImg.rows * job.originalImg.cols;
+
+				log << "Compressed file size: " << comSize << " bytes" << endl;
+				log << "Compression ratio: " << (double)orgSize / comSize << endl;
+				log << "------------------------------------" << endl << endl;
+
+				result.originalSize = orgSize;
+				result.compressedSize = comSize;
+			}
+		}
+		catch (const exception& ex) {
+			log << "ERROR::" << ex.what() << endl;
+		}
+	}
+
+	result.log = log.str();
+
+	// Release the images before printing the result
+	int idx = job.idx;
+	job = FileJob();
+
+	finishFile(pipeline, idx, result);
+}
+
+/**
+ * Main function
+ */
+int main() {
+	boostIO();
+	chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+
+	cout << fixed << setprecision(3);
+
+	// Load the images on their own threads and give each loaded file to the thread pool,
+	// the loaders walk the samples directory as they go so the first files are compressed
+	// right away, and the pool threads steal the queued files of each other so the files
+	// of different sizes keep all of them busy
+	Pipeline pipeline(LOAD_THREADS_COUNT);
+
+	{
+		ThreadPool pool(THREADS_COUNT);
+		vector<thread> loaders;
+		int maxActiveFiles = pool.size() + QUEUE_CAPACITY;
+		pipeline.pool = &pool;
+
+		for (int i = 0; i < LOAD_THREADS_COUNT; ++i) {
+			loaders.push_back(thread(loadStage, ref(pipeline)));
+		}
+
+		FileJob job;
+		while (pipeline.loadedFiles.pop(job)) {
+			// Wait while the pool is behind
+			{
+				unique_lock<mutex> guard(pipeline.filesLock);
+				pipeline.fileFinished.wait(guard, [&pipeline, maxActiveFiles] { return pipeline.activeFiles < maxActiveFiles; });
+				pipeline.activeFiles++;
 			}
 
-			cout << "Compressed file size: " << comSize << " bytes" << endl;
-			cout << "Compression ratio: " << (double)orgSize / comSize << endl;
-			cout << "------------------------------------" << endl << endl;
+			shared_ptr<FileJob> file = make_shared<FileJob>(move(job));
+			pool.submit([&pipeline, file] { processFile(pipeline, *file); });
+
+			job = FileJob();
+		}
+
+		pool.wait();
+		for (int i = 0; i < loaders.size(); ++i) {
+			loaders[i].join();
 		}
 	}
-	catch (const exception& ex) {
-		cout << "ERROR::" << ex.what() << endl;
+
+	if (pipeline.firstLossyFile != INT_MAX) {
+		return 0;
 	}
 
 	// Output average compression ratio
-	cout << "Total compressed files size: " << compressedFilesSize << " bytes" << endl;
-	cout << "Total compression ratio: " << (double) originalFilesSize / compressedFilesSize << endl << endl;
+	cout << "Total compressed files size: " << pipeline.compressedFilesSize << " bytes" << endl;
+	cout << "Total compression ratio: " << (double) pipeline.originalFilesSize / pipeline.compressedFilesSize << endl << endl;
 
 	// Output process time
-	int stopTime = clock();
-	cout << "Time: " << (stopTime - startTime) / double(CLOCKS_PER_SEC) << "sec" << endl;
+	chrono::steady_clock::time_point stopTime = chrono::steady_clock::now();
+	cout << "Time: " << chrono::duration<double>(stopTime - startTime).count() << "sec" << endl;
 	return 0;
 }
\ No newline at end of file
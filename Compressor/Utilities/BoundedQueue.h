@@ -0,0 +1,70 @@
+#pragma once
+// STL libraries
+#include <deque>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+using namespace std;
+
+/**
+ * Queue of a limited number of items passed between threads, pushing into a full queue
+ * blocks until an item is popped so a fast producer can not get far ahead of its consumers
+ */
+template <typename T>
+class BoundedQueue
+{
+private:
+	deque<T> items;
+	size_t capacity;
+	bool closed = false;
+
+	mutex lock;
+	condition_variable notFull;
+	condition_variable notEmpty;
+
+public:
+	BoundedQueue(size_t capacity) : capacity(max((size_t)1, capacity)) {}
+
+	/**
+	 * Append the given item waiting while the queue is full,
+	 * return false if the queue is closed
+	 */
+	bool push(T item) {
+		unique_lock<mutex> guard(lock);
+		notFull.wait(guard, [this] { return items.size() < capacity || closed; });
+
+		if (closed)
+			return false;
+
+		items.push_back(move(item));
+		notEmpty.notify_one();
+		return true;
+	}
+
+	/**
+	 * Take the earliest item waiting while the queue is empty,
+	 * return false if the queue is closed and all its items are taken
+	 */
+	bool pop(T& item) {
+		unique_lock<mutex> guard(lock);
+		notEmpty.wait(guard, [this] { return !items.empty() || closed; });
+
+		if (items.empty())
+			return false;
+
+		item = move(items.front());
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+
+	/**
+	 * Stop accepting items, the queued items can still be taken
+	 */
+	void close() {
+		lock_guard<mutex> guard(lock);
+		closed = true;
+		notFull.notify_all();
+		notEmpty.notify_all();
+	}
+};
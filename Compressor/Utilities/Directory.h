@@ -1,27 +1,150 @@
 #pragma once
-#include <fstream>
+#include <iostream>
 #include <string>
 #include <vector>
+#include <mutex>
+#include <filesystem>
 using namespace std;
 
+/**
+ * Check whether the given name matches the given glob pattern,
+ * where '*' matches any characters and '?' matches a single character
+ */
+inline bool matchesPattern(const string& name, const string& pattern) {
+	size_t n = 0, p = 0;
+	size_t starPattern = string::npos, starName = 0;
+
+	while (n < name.size()) {
+		if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+			++n, ++p;
+		}
+		else if (p < pattern.size() && pattern[p] == '*') {
+			// Match nothing by the star first then extend its match on mismatches
+			starPattern = p++;
+			starName = n;
+		}
+		else if (starPattern != string::npos) {
+			p = starPattern + 1;
+			n = ++starName;
+		}
+		else {
+			return false;
+		}
+	}
+
+	while (p < pattern.size() && pattern[p] == '*') ++p;
+
+	return p == pattern.size();
+}
+
 /**
  * Returns a list of files (name, extension) in the given directory
  */
 inline void getFilesInDirectory(const string& directory, vector<pair<string, string>>& files) {
-	// Make sure to change the following command to the corresponding
-	// one on your operating system when using Linux or MAC
-	string txtPath = "../Compressor/Data/dirs.txt";
+	error_code error;
+	filesystem::directory_iterator it(directory, error), end;
 
-	string s = "ls " + directory + " > " + txtPath;
-	system(s.c_str());
+	if (error) {
+		cerr << "Could not open the directory at: " << directory << endl;
+		return;
+	}
+
+	while (it != end) {
+		if (it->is_regular_file(error)) {
+			string s = it->path().filename().string();
+			int idx = (int)s.size() - 1;
+			while (idx >= 0 && s[idx] != '.') --idx;
+			files.push_back({ s.substr(0, idx), s.substr(idx + 1) });
+		}
+
+		it.increment(error);
+
+		if (error) {
+			cerr << "Could not read the directory at: " << directory << " (" << error.message() << ")" << endl;
+			return;
+		}
+	}
+}
+
+/**
+ * Walks the files of a directory and its sub-directories one file at a time,
+ * so the files can be processed while the directory is still being read;
+ * the walker can be shared by several threads
+ */
+class DirectoryWalker
+{
+private:
+	filesystem::path root;
+	filesystem::recursive_directory_iterator it;
+	string pattern;
+	mutex lock;
 
-	ifstream fin(txtPath);
+public:
+	/**
+	 * Start walking the given directory, only returning the files whose names match the given glob pattern
+	 */
+	DirectoryWalker(const string& directory, const string& pattern = "*") : root(directory), pattern(pattern) {
+		error_code error;
+		it = filesystem::recursive_directory_iterator(root, filesystem::directory_options::skip_permission_denied, error);
 
-	while (getline(fin, s)) {
-		int idx = (int)s.size() - 1;
-		while (idx >= 0 && s[idx] != '.') --idx;
-		files.push_back({ s.substr(0, idx), s.substr(idx + 1) });
+		if (error) {
+			cerr << "Could not open the directory at: " << directory << endl;
+		}
 	}
 
-	remove(txtPath.c_str());
-}
\ No newline at end of file
+	/**
+	 * Find the next matching file and store its path relative to the walked directory,
+	 * return false when all the files are walked
+	 */
+	bool next(string& relativePath) {
+		lock_guard<mutex> guard(lock);
+
+		while (it != filesystem::recursive_directory_iterator()) {
+			error_code error;
+			bool matched = it->is_regular_file(error) && matchesPattern(it->path().filename().string(), pattern);
+
+			if (error) {
+				// Skip the entries that can not be read
+				cerr << "Could not read the directory entry at: " << it->path().string() << " (" << error.message() << ")" << endl;
+			}
+			else if (matched) {
+				relativePath = it->path().lexically_relative(root).generic_string();
+			}
+
+			advance();
+
+			if (matched)
+				return true;
+		}
+
+		return false;
+	}
+
+private:
+	/**
+	 * Move to the next entry, the directories that can not be opened for lack of permission
+	 * are skipped, any other error ends the walk as the iterator can not move past it
+	 */
+	void advance() {
+		error_code error;
+		filesystem::path path = it->path();
+
+		it.increment(error);
+
+		if (error) {
+			cerr << "Could not read the directory after: " << path.string() << " (" << error.message() << ")" << endl;
+			it = filesystem::recursive_directory_iterator();
+		}
+	}
+};
+
+/**
+ * Create the directory of the given file path if it does not exist
+ */
+inline void createParentDirectory(const string& path) {
+	error_code error;
+	filesystem::path parent = filesystem::path(path).parent_path();
+
+	if (!parent.empty())
+		filesystem::create_directories(parent, error);
+}
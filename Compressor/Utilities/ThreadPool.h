@@ -0,0 +1,239 @@
+#pragma once
+// STL libraries
+#include <iostream>
+#include <exception>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+using namespace std;
+
+/**
+ * Pool of threads running the submitted tasks, each thread has its own queue of tasks
+ * and takes the tasks of its own queue in order, when its queue is empty it steals
+ * the last queued task of another thread, so no thread is left idle while there are
+ * still queued tasks of any size; a task throwing an exception is reported
+ * and does not stop its thread
+ */
+class ThreadPool
+{
+private:
+	struct TaskQueue {
+		mutex lock;
+		deque<function<void()>> tasks;
+	};
+
+	vector<unique_ptr<TaskQueue>> queues;   // Task queue of each thread
+	vector<thread> workers;
+	int nextQueue = 0;                      // Queue of the next submitted task, the tasks are spread in turn
+
+	mutex stateLock;
+	condition_variable taskAdded;
+	condition_variable tasksDone;
+	int queuedTasks = 0;                    // Number of submitted tasks not taken by any thread yet
+	int unfinishedTasks = 0;                // Number of submitted tasks not finished yet
+	bool stopping = false;
+
+public:
+	/**
+	 * Start the given number of threads, or a thread per hardware thread if not positive
+	 */
+	ThreadPool(int threadsCount = 0) {
+		if (threadsCount <= 0)
+			threadsCount = max(1, (int)thread::hardware_concurrency());
+
+		for (int i = 0; i < threadsCount; ++i) {
+			queues.push_back(unique_ptr<TaskQueue>(new TaskQueue()));
+		}
+		for (int i = 0; i < threadsCount; ++i) {
+			workers.push_back(thread(&ThreadPool::run, this, i));
+		}
+	}
+
+	/**
+	 * Finish all the submitted tasks then stop the threads
+	 */
+	~ThreadPool() {
+		wait();
+
+		{
+			lock_guard<mutex> guard(stateLock);
+			stopping = true;
+		}
+
+		taskAdded.notify_all();
+		for (int i = 0; i < workers.size(); ++i) {
+			workers[i].join();
+		}
+	}
+
+	/**
+	 * Queue the given task to be run by one of the threads
+	 */
+	void submit(function<void()> task) {
+		int queueIdx;
+
+		// Count the task before queuing it so it is never finished before being counted,
+		// the tasks can be submitted by several threads including the pool threads
+		{
+			lock_guard<mutex> guard(stateLock);
+			queuedTasks++;
+			unfinishedTasks++;
+			queueIdx = nextQueue;
+			nextQueue = (nextQueue + 1) % queues.size();
+		}
+		{
+			TaskQueue& queue = *queues[queueIdx];
+			lock_guard<mutex> guard(queue.lock);
+			queue.tasks.push_back(move(task));
+		}
+
+		taskAdded.notify_one();
+	}
+
+	/**
+	 * Run the given task for each index in [0, count) on the calling thread and at most count - 1
+	 * pool threads, and return when all the indecies are run; the calling thread runs the indecies
+	 * not taken by the pool threads and only waits for the started helpers, so it can be called
+	 * from a pool task while the other pool threads are busy; the first thrown exception is rethrown
+	 */
+	void parallelFor(int count, function<void(int)> task) {
+		struct TaskGroup {
+			atomic<int> nextIdx;
+			mutex lock;
+			condition_variable helpersDone;
+			int activeHelpers = 0;
+			bool closed = false;                // No more helpers can start once the indecies are run
+			exception_ptr error;
+		};
+
+		shared_ptr<TaskGroup> group = make_shared<TaskGroup>();
+		group->nextIdx = 0;
+
+		function<void()> runIndecies = [group, task, count] {
+			try {
+				for (int i = group->nextIdx++; i < count; i = group->nextIdx++) {
+					task(i);
+				}
+			}
+			catch (...) {
+				lock_guard<mutex> guard(group->lock);
+				if (!group->error)
+					group->error = current_exception();
+			}
+		};
+
+		for (int h = 1; h < count && h < workers.size(); ++h) {
+			submit([group, runIndecies] {
+				{
+					lock_guard<mutex> guard(group->lock);
+					if (group->closed)
+						return;
+					group->activeHelpers++;
+				}
+
+				runIndecies();
+
+				lock_guard<mutex> guard(group->lock);
+				if (--group->activeHelpers == 0)
+					group->helpersDone.notify_all();
+			});
+		}
+
+		runIndecies();
+
+		unique_lock<mutex> guard(group->lock);
+		group->closed = true;
+		group->helpersDone.wait(guard, [&group] { return group->activeHelpers == 0; });
+
+		if (group->error)
+			rethrow_exception(group->error);
+	}
+
+	/**
+	 * Block until all the submitted tasks are finished
+	 */
+	void wait() {
+		unique_lock<mutex> guard(stateLock);
+		tasksDone.wait(guard, [this] { return unfinishedTasks == 0; });
+	}
+
+	/**
+	 * Return the number of threads of the pool
+	 */
+	int size() const {
+		return workers.size();
+	}
+
+private:
+	/**
+	 * Keep running the tasks of the given thread's queue, or the stolen tasks of the other queues
+	 */
+	void run(int idx) {
+		function<void()> task;
+
+		while (true) {
+			{
+				// Sleep until a task is queued or the pool is stopped
+				unique_lock<mutex> guard(stateLock);
+				taskAdded.wait(guard, [this] { return queuedTasks > 0 || stopping; });
+
+				if (queuedTasks == 0)
+					return;
+			}
+
+			if (!takeTask(idx, task))
+				continue;
+
+			try {
+				task();
+			}
+			catch (const exception& ex) {
+				cerr << "ERROR::" << ex.what() << endl;
+			}
+			catch (...) {
+				cerr << "ERROR::Unknown exception thrown by a pool task" << endl;
+			}
+			task = nullptr;
+
+			{
+				lock_guard<mutex> guard(stateLock);
+				if (--unfinishedTasks == 0)
+					tasksDone.notify_all();
+			}
+		}
+	}
+
+	/**
+	 * Take the earliest task of the given thread's queue, or steal the latest task
+	 * of the next non-empty queue, return false if all the queues are empty
+	 */
+	bool takeTask(int idx, function<void()>& task) {
+		for (int k = 0; k < queues.size(); ++k) {
+			TaskQueue& queue = *queues[(idx + k) % queues.size()];
+			lock_guard<mutex> guard(queue.lock);
+
+			if (queue.tasks.empty())
+				continue;
+
+			if (k == 0) {
+				task = move(queue.tasks.front());
+				queue.tasks.pop_front();
+			}
+			else {
+				task = move(queue.tasks.back());
+				queue.tasks.pop_back();
+			}
+
+			lock_guard<mutex> stateGuard(stateLock);
+			queuedTasks--;
+			return true;
+		}
+
+		return false;
+	}
+};
@@ -1,6 +1,7 @@
 #pragma once
 // STL libraries
 #include <string>
+#include <fstream>
 
 // OpenCV libraries
 #include <opencv2/core/core.hpp>
@@ -0,0 +1,200 @@
+#pragma once
+// STL libraries
+#include <iostream>
+#include <string>
+#include <vector>
+#include <climits>
+
+// Custom libraries
+#include "Utility.h"
+#include "ThreadPool.h"
+#include "../Compressors/Compressor.h"
+#include "../Compressors/DocumentCompressor.h"
+using namespace std;
+
+/**
+ * Compress the given image using the given configured compressor and extract it
+ * using a fresh one so the compression settings can not leak into the extraction,
+ * the image rows are read in stripes through a row source if requested,
+ * return true if the image is restored
+ */
+inline bool verifyRoundTrip(Compressor& compressor, const cv::Mat& originalImg, bool readStripes = false) {
+	Compressor extractor;
+	vector<uchar> compressedBytes;
+	cv::Mat uncompressedImg;
+
+	if (readStripes) {
+		MatRowSource source(originalImg);
+		compressor.compress(source, compressedBytes);
+	}
+	else {
+		compressor.compress(originalImg, compressedBytes);
+	}
+	extractor.extract(compressedBytes, uncompressedImg);
+
+	return compareImages(originalImg, uncompressedImg);
+}
+
+/**
+ * Compress and extract the given image using each of the non-default compression options,
+ * return false and the name of the failed option if any of them does not restore the image,
+ * the parallel options run on the given thread pool if any
+ */
+inline bool verifyOptions(const cv::Mat& originalImg, string& failedOption, ThreadPool* pool = NULL) {
+	// Interleaved Huffman streams
+	{
+		Compressor compressor;
+		compressor.setHuffmanStreamsCount(4);
+
+		if (!verifyRoundTrip(compressor, originalImg)) {
+			failedOption = "4 Huffman streams";
+			return false;
+		}
+	}
+
+	// Range coder
+	{
+		Compressor compressor;
+		compressor.setEntropyCoder(ENTROPY_ARITHMETIC);
+
+		if (!verifyRoundTrip(compressor, originalImg)) {
+			failedOption = "arithmetic coder";
+			return false;
+		}
+	}
+
+	// Asymmetric numeral systems coder
+	{
+		Compressor compressor;
+		compressor.setEntropyCoder(ENTROPY_ANS);
+
+		if (!verifyRoundTrip(compressor, originalImg)) {
+			failedOption = "ANS coder";
+			return false;
+		}
+	}
+
+	// Stream VByte data layout
+	{
+		Compressor compressor;
+		compressor.setStreamVByte(true);
+
+		if (!verifyRoundTrip(compressor, originalImg)) {
+			failedOption = "Stream VByte";
+			return false;
+		}
+	}
+
+	// Shapes encoded and runs labelled in parallel
+	{
+		Compressor compressor;
+		compressor.setThreadsCount(4);
+		compressor.setThreadPool(pool);
+
+		if (!verifyRoundTrip(compressor, originalImg)) {
+			failedOption = "4 threads";
+			return false;
+		}
+	}
+
+	// Symmetric shapes stored by their halves
+	{
+		Compressor compressor;
+		compressor.setShapeSymmetry(true);
+
+		if (!verifyRoundTrip(compressor, originalImg)) {
+			failedOption = "shape symmetry";
+			return false;
+		}
+	}
+
+	// Image rows read in stripes
+	{
+		Compressor compressor;
+
+		if (!verifyRoundTrip(compressor, originalImg, true)) {
+			failedOption = "row stripes";
+			return false;
+		}
+	}
+
+	// Separately decodable tiles, extracting the middle of the image only
+	{
+		Compressor compressor, extractor;
+		vector<uchar> compressedBytes;
+		cv::Mat uncompressedImg;
+		cv::Rect region(originalImg.cols / 4, originalImg.rows / 4, originalImg.cols / 2, originalImg.rows / 2);
+
+		compressor.setSpatialIndex(true);
+		compressor.compress(originalImg, compressedBytes);
+
+		extractor.extract(compressedBytes, uncompressedImg);
+		if (!compareImages(originalImg, uncompressedImg)) {
+			failedOption = "spatial index";
+			return false;
+		}
+
+		extractor.extract(compressedBytes, region, uncompressedImg);
+		if (!compareImages(originalImg(region), uncompressedImg)) {
+			failedOption = "spatial index region";
+			return false;
+		}
+	}
+
+	// Tiles encoded using all the other options as each tile runs through the same encoding
+	{
+		Compressor compressor;
+		compressor.setEntropyCoder(ENTROPY_ANS);
+		compressor.setHuffmanStreamsCount(4);
+		compressor.setStreamVByte(true);
+		compressor.setShapeSymmetry(true);
+		compressor.setSpatialIndex(true);
+		compressor.setThreadsCount(4);
+		compressor.setThreadPool(pool);
+
+		if (!verifyRoundTrip(compressor, originalImg, true)) {
+			failedOption = "all options";
+			return false;
+		}
+	}
+
+	// Image stored twice in a document so all its shapes are shared by the pages
+	{
+		DocumentCompressor compressor, extractor;
+		vector<cv::Mat> pages(2, originalImg), extractedPages;
+		vector<uchar> compressedBytes;
+
+		compressor.compress(pages, compressedBytes);
+		extractor.extract(compressedBytes, extractedPages);
+
+		for (int i = 0; i < pages.size(); ++i) {
+			if (i >= extractedPages.size() || !compareImages(pages[i], extractedPages[i])) {
+				failedOption = "multi-page document";
+				return false;
+			}
+		}
+	}
+
+	// Repeated shapes of the image referred to in a dictionary trained on the image
+	{
+		Compressor compressor, extractor;
+		ShapeDictionary dictionary;
+		vector<uchar> dictionaryBytes, compressedBytes;
+		cv::Mat uncompressedImg;
+
+		compressor.trainDictionary(vector<cv::Mat>(1, originalImg), INT_MAX, dictionary);
+		compressor.compressDictionary(dictionary, dictionaryBytes);
+
+		compressor.setDictionary(&dictionary);
+		compressor.compress(originalImg, compressedBytes);
+
+		extractor.loadDictionary(dictionaryBytes);
+		extractor.extract(compressedBytes, uncompressedImg);
+		if (!compareImages(originalImg, uncompressedImg)) {
+			failedOption = "shared dictionary";
+			return false;
+		}
+	}
+
+	return true;
+}